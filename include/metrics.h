@@ -0,0 +1,46 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+// Live statistics block shared through /dev/shm/myshell.<pid>.stats.
+// The shell updates it with relaxed atomics; readers (tools/myshell-stat)
+// map it read-only and never lock or signal the shell.
+
+#define SHELL_STATS_MAGIC   0x4853594du // "MYSH"
+#define SHELL_STATS_VERSION 1
+#define SHELL_STATS_DIR     "/dev/shm"
+#define SHELL_STATS_PREFIX  "myshell."
+#define SHELL_STATS_SUFFIX  ".stats"
+#define SHELL_STATS_CMD_MAX 256
+
+typedef struct shell_stats_t {
+    uint32_t magic;
+    uint32_t version;
+    int32_t pid;
+    uint32_t size;               // sizeof(shell_stats_t), for layout checks
+    uint64_t start_time;         // Seconds since the epoch
+
+    uint64_t commands_executed;  // Builtins and external commands
+    uint64_t forks;
+    uint64_t builtin_hits;
+    uint64_t jobs_active;
+    uint64_t jobs_finished;
+    uint64_t child_cpu_us;       // User + system time of reaped children
+    uint64_t parse_time_ns;      // Total time spent in parse_command()
+    uint64_t parse_count;
+
+    // current_command is guarded by a sequence counter: odd while it is being
+    // rewritten, so a reader retries if the counter is odd or changed.
+    uint64_t command_seq;
+    char current_command[SHELL_STATS_CMD_MAX];
+} shell_stats_t;
+
+#define METRIC_ADD(field, n) __atomic_fetch_add(&shell_stats->field, (uint64_t)(n), __ATOMIC_RELAXED)
+#define METRIC_SUB(field, n) __atomic_fetch_sub(&shell_stats->field, (uint64_t)(n), __ATOMIC_RELAXED)
+#define METRIC_SET(field, v) __atomic_store_n(&shell_stats->field, (uint64_t)(v), __ATOMIC_RELAXED)
+#define METRIC_INC(field)    METRIC_ADD(field, 1)
+
+extern shell_stats_t* shell_stats;
+
+#endif // METRICS_H
@@ -0,0 +1,30 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+
+// Wire protocol between `myshell --serve SOCKET` and tools/myshell-client.
+//
+// The client connects to the AF_UNIX stream socket and sends one request:
+// a server_request_t header, carrying its stdin, stdout and stderr as
+// SCM_RIGHTS ancillary data, followed by line_len bytes of command line and
+// cwd_len bytes of working directory (0 keeps the server's). The shell runs
+// the line there with those descriptors and answers with a server_reply_t
+// once the command has finished.
+
+#define SERVER_MAGIC    0x5652534du // "MSRV"
+#define SERVER_LINE_MAX (1024 * 1024)
+#define SERVER_NFDS     3
+
+typedef struct server_request_t {
+    uint32_t magic;
+    uint32_t line_len;
+    uint32_t cwd_len;
+} server_request_t;
+
+typedef struct server_reply_t {
+    uint32_t magic;
+    int32_t status; // Exit status of the line, 128+N if killed by signal N
+} server_reply_t;
+
+#endif // SERVER_H
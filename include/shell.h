@@ -1,27 +1,48 @@
 #ifndef SHELL_H
 #define SHELL_H
 
+// Linux extensions: F_SETPIPE_SZ, sched_setaffinity, CPU_SET
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 // Required includes based on features implemented up to Feature-6
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <errno.h>
 #include <ctype.h> // Added for Feature-6 whitespace trimming
+#include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+#include <termios.h> // Job control: terminal modes of stopped jobs
+#include <sched.h>   // Pipeline CPU pinning
+#include <poll.h>
+#include <sys/resource.h> // `limit` prefix
+#include <sys/syscall.h>  // pidfd_open
+
+// Event loop: epoll, signalfd and timerfd (Linux specific)
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+// Default values of $SHELL and $VERSION
+#define MYSHELL_PATH "/bin/myshell"
+#define MYSHELL_VERSION "v7+"
 
-// Feature-3: Command History size
+// Feature-3: Lines listed by `history`
 #define HISTORY_SIZE 20
 
 // Feature-4: Readline includes
 #include <readline/readline.h>
 #include <readline/history.h>
 
-// Global variable for history
-extern char* custom_history_list[HISTORY_SIZE];
-extern int history_count;
+#include "metrics.h"
 
 // Struct to hold parsed command data (extended for Feature-6)
 typedef struct command_t {
@@ -32,32 +53,171 @@ typedef struct command_t {
     
     // Feature-6 additions
     int is_background;      // Flag for '&' background execution
-    struct command_t* next_chain; // For ';' command chaining
+    struct command_t* next_chain; // For ';', '&&' and '||' chaining
+    int chain_op;           // CHAIN_* operator joining this link to the previous one
 } command_t;
 
+// How a chain link runs relative to the link before it
+enum { CHAIN_ALWAYS, CHAIN_AND, CHAIN_OR }; // ';' (or first), '&&', '||'
+
+// Feature-9: Job record. Every pipeline runs in its own process group;
+// foreground jobs only enter the job list once they are stopped.
+typedef struct job_t {
+    pid_t pgid;          // Process group shared by all stages
+    int shared_pgid;     // pgid is a dag task's group: signal and wait by pid
+    pid_t* pids;         // Every process in the pipeline
+    char* reaped;        // Per process: set once its exit status was collected
+    int nprocs;
+    int alive;           // Processes not yet reaped
+    int last_status;     // Wait status of the final stage
+    char* cmd_line;
+    int job_id;          // 0 until the job is placed in the job list
+    char* status;        // E.g., "Running", "Done", "Stopped"
+    struct termios tmodes; // Terminal modes saved when the job stopped
+    int has_tmodes;
+    int timer_fd;        // Fires at the `timeout` deadline, -1 if none
+    int timed_out;       // 1 once SIGTERM was sent, 2 once SIGKILL was
+    int mem_limited;     // Started under a `limit -m` address-space cap
+    struct job_t* next;
+} job_t;
+
+// Resource caps from the `timeout` and `limit` command prefixes
+typedef struct exec_limits_t {
+    long timeout_ms;      // 0 = no timeout
+    rlim_t cpu_seconds;   // RLIM_INFINITY = unchanged
+    rlim_t address_space;
+    rlim_t open_files;
+} exec_limits_t;
+
+// Growable, always NUL-terminated string (strbuf.c)
+typedef struct strbuf_t {
+    char* data;
+    size_t len;
+    size_t cap;
+} strbuf_t;
+
+// Pipeline tuning, changed with `set -o NAME=VALUE`
+enum { PIN_OFF, PIN_ROUND_ROBIN, PIN_LAYOUT };
+
+typedef struct shell_options_t {
+    int pipe_size;       // F_SETPIPE_SZ for every pipeline pipe, 0 = kernel default
+    int pin_mode;        // PIN_OFF, PIN_ROUND_ROBIN or PIN_LAYOUT
+    int* cpu_layout;     // PIN_LAYOUT: stage i runs on cpu_layout[i % cpu_layout_len]
+    int cpu_layout_len;
+} shell_options_t;
+
+extern shell_options_t shell_options;
+
+// Job control state (main.c)
+extern int shell_is_interactive;
+extern pid_t shell_pgid;
+extern int shell_signal_fd;
+
+// Callback invoked by the event loop when a watched fd becomes readable
+typedef void (*event_cb_t)(int fd, void* data);
+
 // --- Function Prototypes ---
 
 // main.c
 void setup_environment();
 void cleanup_resources();
-void sigchld_handler(int sig); // For zombie prevention (Feature-6)
-void sigint_handler(int sig);  // To ignore Ctrl+C (Feature-6)
+void reset_child_signals(void); // Undo the shell's signal mask in a forked child
+void reap_children(void);       // Collect finished children without blocking
+void shell_notify(const char* fmt, ...); // Print without corrupting the prompt
+void give_terminal_to(pid_t pgid, const struct termios* modes);
+void process_line(char* line);
+
+// metrics.c
+void metrics_init(void);
+void metrics_cleanup(void);
+void metrics_set_command(const char* line);
+void metrics_update_child_cpu(void);
+uint64_t metrics_now_ns(void);
+
+// dag.c
+void shell_dag(command_t* cmd);
+
+// events.c
+int events_init(void);
+int events_add_fd(int fd, event_cb_t callback, void* data);
+void events_remove_fd(int fd);
+int events_add_timer(long first_ms, long interval_ms, event_cb_t callback, void* data);
+void events_run(void);
+void events_stop(void);
 
 // shell.c
 char** my_completion(const char* text, int start, int end);
 command_t* parse_command(char* line);
 command_t* parse_chain_segment(char* segment); // Helper for parsing
+command_t* parse_command_cached(char* line);
+int parse_is_cacheable(const char* line);
+void free_command_chain(command_t* head);
+command_t* clone_command(const command_t* cmd);
 void free_command(command_t* cmd);
+void set_shell_var(const char* name, const char* value);
+char* get_shell_var(const char* name);
+void foreach_shell_var(void (*fn)(const char* name, const char* value, void* data), void* data);
 int handle_builtin(command_t* cmd);
-void init_history();
 void add_to_history_list(const char* cmd);
 int reexecute_history(command_t* cmd);
+job_t* create_job(const char* cmd_line);
+void job_add_process(job_t* job, pid_t pid);
+void put_job_in_background(job_t* job);
+void wait_for_job(job_t* job);
+void job_reaped(pid_t pid, int status);
+void job_set_timeout(job_t* job, long timeout_ms);
+long parse_size(const char* text);
+void hangup_jobs(void);
+void cleanup_job_list(void);
+
+// strbuf.c
+void sb_init(strbuf_t* sb);
+void sb_append(strbuf_t* sb, const char* s);
+void sb_append_n(strbuf_t* sb, const char* s, size_t n);
+void sb_append_char(strbuf_t* sb, char c);
+void sb_clear(strbuf_t* sb);
+char* sb_detach(strbuf_t* sb);
+void sb_free(strbuf_t* sb);
+
+// history_index.c
+void history_index_add(const char* line);
+size_t history_index_search(const char* pattern, uint32_t before, uint32_t* results, size_t max);
+uint32_t history_index_count(void);
+const char* history_index_entry(uint32_t id);
+uint32_t history_index_number(uint32_t id);
+const char* history_index_lookup(uint32_t number);
+int history_index_isearch(int count, int key);
+void cleanup_history_index(void);
+
+// glob.c
+int has_glob_chars(const char* s);
+char** expand_glob(const char* pattern, size_t* count);
 
 // execute.c
 void execute_command(command_t* cmd);
+void execute_chain(command_t* head);
 void execute_simple_command(command_t* cmd);
 void execute_piped_command(command_t* cmd);
 void setup_redirection(command_t* cmd);
+int run_stage_builtin(command_t* cmd);
+const char* resolve_command(const char* name);
+void clear_path_cache(void);
+void shell_hash(command_t* cmd);
+
+// rc.c
+void init_shell_vars(void);
+void load_rc_file(void);
+
+// server.c
+int run_server(const char* path, int workers);
+int server_worker_exited(pid_t pid, int status);
+
+// xargs.c
+int shell_xargs(command_t* cmd);
+
+// zerocopy.c
+int shell_cat(command_t* cmd);
+int shell_tee(command_t* cmd);
 
 #endif // SHELL_H
 
@@ -0,0 +1,392 @@
+#include "shell.h"
+
+// Global variables imported from main.c
+extern int last_exit_status;
+
+// --- dag builtin: runs a file of dependent tasks in parallel ---
+//
+//   dag [-j N] [-k] FILE
+//
+// Each line of FILE (blank lines and '#' comments aside) defines a task:
+//   name: command line
+//   name(dep1, dep2): command line
+// A task starts once all its dependencies have succeeded, with up to N
+// tasks (default: online CPUs) running at once. Each runs in a subshell
+// with its own process group and stdin from /dev/null. After a failure no
+// further tasks start; with -k only the failed task's dependents are
+// skipped. Ctrl+C interrupts every running task.
+
+enum { TASK_PENDING, TASK_RUNNING, TASK_DONE, TASK_FAILED, TASK_SKIPPED };
+
+typedef struct dag_task_t {
+    char* name;
+    char* command;
+    char** dep_names;    // As written, resolved into deps once all are read
+    int ndeps;
+    int* dependents;     // Tasks that list this one as a dependency
+    int ndependents;
+    int waiting;         // Dependencies not yet done
+    int state;
+    pid_t pid;
+    int pidfd;
+} dag_task_t;
+
+typedef struct dag_t {
+    dag_task_t* tasks;
+    int ntasks;
+    int* ready;          // FIFO of runnable task indices (file order)
+    int ready_head;
+    int ready_tail;
+    int running;
+    int stop;            // No new tasks: a failure without -k, or Ctrl+C
+    int keep_going;
+    int status;          // $? of the whole run
+} dag_t;
+
+static void free_dag(dag_t* dag) {
+    for (int i = 0; i < dag->ntasks; i++) {
+        dag_task_t* task = &dag->tasks[i];
+        free(task->name);
+        free(task->command);
+        for (int j = 0; j < task->ndeps; j++) free(task->dep_names[j]);
+        free(task->dep_names);
+        free(task->dependents);
+    }
+    free(dag->tasks);
+    free(dag->ready);
+}
+
+static char* trim(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    size_t len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len - 1])) s[--len] = '\0';
+    return s;
+}
+
+static int valid_task_name(const char* name) {
+    if (name[0] == '\0') return 0;
+    for (const char* p = name; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_' && *p != '-' && *p != '.') return 0;
+    }
+    return 1;
+}
+
+static int find_task(dag_t* dag, const char* name) {
+    for (int i = 0; i < dag->ntasks; i++) {
+        if (strcmp(dag->tasks[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Parses "name(deps): command" into a new task; returns -1 on a bad line
+static int add_task_line(dag_t* dag, char* line, const char* file, int lineno) {
+    char* colon = strchr(line, ':');
+    char* paren = strchr(line, '(');
+    if (colon == NULL || (paren != NULL && paren > colon)) paren = NULL;
+
+    char* deps_text = NULL;
+    if (paren != NULL) {
+        char* close_paren = strchr(paren, ')');
+        if (close_paren == NULL || close_paren > colon) {
+            fprintf(stderr, "myshell: dag: %s:%d: missing ')'\n", file, lineno);
+            return -1;
+        }
+        *paren = '\0';
+        *close_paren = '\0';
+        deps_text = paren + 1;
+    }
+    if (colon == NULL) {
+        fprintf(stderr, "myshell: dag: %s:%d: expected 'name: command'\n", file, lineno);
+        return -1;
+    }
+    *colon = '\0';
+
+    char* name = trim(line);
+    char* command = trim(colon + 1);
+    if (!valid_task_name(name) || command[0] == '\0') {
+        fprintf(stderr, "myshell: dag: %s:%d: expected 'name: command'\n", file, lineno);
+        return -1;
+    }
+    if (find_task(dag, name) >= 0) {
+        fprintf(stderr, "myshell: dag: %s:%d: task '%s' defined twice\n", file, lineno, name);
+        return -1;
+    }
+
+    dag->tasks = (dag_task_t*)realloc(dag->tasks, (dag->ntasks + 1) * sizeof(dag_task_t));
+    dag_task_t* task = &dag->tasks[dag->ntasks++];
+    memset(task, 0, sizeof(*task));
+    task->name = strdup(name);
+    task->command = strdup(command);
+    task->state = TASK_PENDING;
+    task->pidfd = -1;
+
+    char* saveptr = NULL;
+    for (char* dep = deps_text ? strtok_r(deps_text, ",", &saveptr) : NULL; dep != NULL;
+         dep = strtok_r(NULL, ",", &saveptr)) {
+        dep = trim(dep);
+        if (dep[0] == '\0') continue;
+        task->dep_names = (char**)realloc(task->dep_names, (task->ndeps + 1) * sizeof(char*));
+        task->dep_names[task->ndeps++] = strdup(dep);
+    }
+    return 0;
+}
+
+// Links dependencies and rejects unknown names and cycles
+static int resolve_dag(dag_t* dag, const char* file) {
+    for (int i = 0; i < dag->ntasks; i++) {
+        dag_task_t* task = &dag->tasks[i];
+        for (int j = 0; j < task->ndeps; j++) {
+            int dep = find_task(dag, task->dep_names[j]);
+            if (dep < 0) {
+                fprintf(stderr, "myshell: dag: %s: task '%s' depends on unknown task '%s'\n",
+                        file, task->name, task->dep_names[j]);
+                return -1;
+            }
+            dag_task_t* parent = &dag->tasks[dep];
+            parent->dependents = (int*)realloc(parent->dependents, (parent->ndependents + 1) * sizeof(int));
+            parent->dependents[parent->ndependents++] = i;
+            task->waiting++;
+        }
+    }
+
+    // Kahn's algorithm on a copy of the counts: anything left over is in a cycle
+    int* waiting = (int*)malloc(dag->ntasks * sizeof(int));
+    int* queue = (int*)malloc(dag->ntasks * sizeof(int));
+    int head = 0, tail = 0;
+    for (int i = 0; i < dag->ntasks; i++) {
+        waiting[i] = dag->tasks[i].waiting;
+        if (waiting[i] == 0) queue[tail++] = i;
+    }
+    while (head < tail) {
+        dag_task_t* task = &dag->tasks[queue[head++]];
+        for (int j = 0; j < task->ndependents; j++) {
+            if (--waiting[task->dependents[j]] == 0) queue[tail++] = task->dependents[j];
+        }
+    }
+    int status = 0;
+    if (tail < dag->ntasks) {
+        for (int i = 0; i < dag->ntasks; i++) {
+            if (waiting[i] > 0) {
+                fprintf(stderr, "myshell: dag: %s: dependency cycle through task '%s'\n", file, dag->tasks[i].name);
+                break;
+            }
+        }
+        status = -1;
+    }
+    free(waiting);
+    free(queue);
+    return status;
+}
+
+static int load_dag(dag_t* dag, const char* file) {
+    FILE* fp = fopen(file, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "myshell: dag: %s: %s\n", file, strerror(errno));
+        return -1;
+    }
+
+    char* line = NULL;
+    size_t cap = 0;
+    int lineno = 0;
+    int status = 0;
+    while (status == 0 && getline(&line, &cap, fp) >= 0) {
+        lineno++;
+        char* text = trim(line);
+        if (text[0] == '\0' || text[0] == '#') continue;
+        status = add_task_line(dag, text, file, lineno);
+    }
+    free(line);
+    fclose(fp);
+
+    return status == 0 ? resolve_dag(dag, file) : -1;
+}
+
+static void launch_task(dag_t* dag, int index) {
+    dag_task_t* task = &dag->tasks[index];
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        reset_child_signals();
+
+        int devnull = open("/dev/null", O_RDONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+            close(devnull);
+        }
+
+        // A subshell: no job control, so its jobs share its group
+        shell_is_interactive = 0;
+        execute_chain(parse_command(task->command));
+        fflush(stdout);
+        exit(last_exit_status);
+    } else if (pid < 0) {
+        perror("myshell: dag: fork error");
+        task->state = TASK_FAILED;
+        dag->status = 1;
+        dag->stop = 1;
+        return;
+    }
+
+    METRIC_INC(forks);
+    setpgid(pid, pid);
+    task->pid = pid;
+    task->pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    task->state = TASK_RUNNING;
+    dag->running++;
+}
+
+// Marks everything downstream of a failed task as not to be run
+static void skip_dependents(dag_t* dag, dag_task_t* task) {
+    for (int j = 0; j < task->ndependents; j++) {
+        dag_task_t* dependent = &dag->tasks[task->dependents[j]];
+        if (dependent->state == TASK_PENDING) {
+            dependent->state = TASK_SKIPPED;
+            skip_dependents(dag, dependent);
+        }
+    }
+}
+
+static void finish_task(dag_t* dag, dag_task_t* task, int status) {
+    dag->running--;
+    if (task->pidfd >= 0) {
+        close(task->pidfd);
+        task->pidfd = -1;
+    }
+
+    int exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (exit_code == 0) {
+        task->state = TASK_DONE;
+        for (int j = 0; j < task->ndependents; j++) {
+            int next = task->dependents[j];
+            if (--dag->tasks[next].waiting == 0 && dag->tasks[next].state == TASK_PENDING) {
+                dag->ready[dag->ready_tail++] = next;
+            }
+        }
+        return;
+    }
+
+    task->state = TASK_FAILED;
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "myshell: dag: task '%s' killed by signal %d\n", task->name, WTERMSIG(status));
+    } else {
+        fprintf(stderr, "myshell: dag: task '%s' failed (exit %d)\n", task->name, exit_code);
+    }
+    if (dag->status == 0) dag->status = exit_code;
+    skip_dependents(dag, task);
+    if (!dag->keep_going) dag->stop = 1;
+}
+
+// Sleeps until a running task exits (or Ctrl+C), then collects what finished.
+// Returns 1 if other children of the shell need reaping afterwards.
+static int wait_for_tasks(dag_t* dag) {
+    struct pollfd* fds = (struct pollfd*)calloc(dag->ntasks + 1, sizeof(struct pollfd));
+    int nfds = 0;
+    int have_pidfds = 1;
+    int reap_others = 0;
+
+    fds[nfds].fd = shell_signal_fd;
+    fds[nfds++].events = POLLIN;
+    for (int i = 0; i < dag->ntasks; i++) {
+        if (dag->tasks[i].state != TASK_RUNNING) continue;
+        if (dag->tasks[i].pidfd < 0) have_pidfds = 0;
+        fds[nfds].fd = dag->tasks[i].pidfd;
+        fds[nfds++].events = POLLIN;
+    }
+
+    // Without pidfds (kernels before 5.3) fall back to short sleeps
+    if (poll(fds, nfds, have_pidfds ? -1 : 10) < 0 && errno != EINTR) {
+        perror("myshell: dag: poll error");
+    }
+    if (fds[0].revents & POLLIN) {
+        struct signalfd_siginfo info;
+        while (read(shell_signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            if (info.ssi_signo == SIGCHLD) {
+                reap_others = 1;
+            } else if (info.ssi_signo == SIGINT || info.ssi_signo == SIGTERM) {
+                for (int i = 0; i < dag->ntasks; i++) {
+                    if (dag->tasks[i].state == TASK_RUNNING) kill(-dag->tasks[i].pid, SIGINT);
+                }
+                dag->stop = 1;
+                if (dag->status == 0) dag->status = 128 + SIGINT;
+            }
+        }
+    }
+    free(fds);
+
+    for (int i = 0; i < dag->ntasks; i++) {
+        dag_task_t* task = &dag->tasks[i];
+        int status;
+        if (task->state == TASK_RUNNING && waitpid(task->pid, &status, WNOHANG) == task->pid) {
+            finish_task(dag, task, status);
+        }
+    }
+    return reap_others;
+}
+
+void shell_dag(command_t* cmd) {
+    char** args = cmd->arglist;
+    long jobs = 0;
+    int keep_going = 0;
+    int i = 1;
+
+    for (; args[i] != NULL && args[i][0] == '-'; i++) {
+        if (strcmp(args[i], "-k") == 0) {
+            keep_going = 1;
+        } else if (strcmp(args[i], "-j") == 0 && args[i + 1] != NULL && atol(args[i + 1]) > 0) {
+            jobs = atol(args[++i]);
+        } else {
+            break;
+        }
+    }
+    if (args[i] == NULL || args[i + 1] != NULL) {
+        fprintf(stderr, "myshell: usage: dag [-j N] [-k] FILE\n");
+        last_exit_status = 2;
+        return;
+    }
+    if (jobs <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? cpus : 1;
+    }
+
+    dag_t dag;
+    memset(&dag, 0, sizeof(dag));
+    dag.keep_going = keep_going;
+    if (load_dag(&dag, args[i]) < 0) {
+        free_dag(&dag);
+        last_exit_status = 2;
+        return;
+    }
+
+    dag.ready = (int*)malloc((dag.ntasks ? dag.ntasks : 1) * sizeof(int));
+    for (int t = 0; t < dag.ntasks; t++) {
+        if (dag.tasks[t].waiting == 0) dag.ready[dag.ready_tail++] = t;
+    }
+
+    int reap_others = 0;
+    while (1) {
+        while (!dag.stop && dag.running < jobs && dag.ready_head < dag.ready_tail) {
+            int next = dag.ready[dag.ready_head++];
+            if (dag.tasks[next].state == TASK_PENDING) launch_task(&dag, next);
+        }
+        if (dag.running == 0) break;
+        reap_others |= wait_for_tasks(&dag);
+    }
+    if (reap_others) {
+        reap_children(); // SIGCHLDs of background jobs were consumed above
+    }
+
+    int failed = 0, not_run = 0;
+    for (int t = 0; t < dag.ntasks; t++) {
+        if (dag.tasks[t].state == TASK_FAILED) failed++;
+        if (dag.tasks[t].state == TASK_PENDING || dag.tasks[t].state == TASK_SKIPPED) not_run++;
+    }
+    if (failed > 0 || not_run > 0) {
+        fprintf(stderr, "myshell: dag: %d failed, %d not run, %d done\n",
+                failed, not_run, dag.ntasks - failed - not_run);
+    }
+
+    last_exit_status = dag.status;
+    free_dag(&dag);
+}
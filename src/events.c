@@ -0,0 +1,167 @@
+#include "shell.h"
+
+// --- Event Loop: a single epoll instance for stdin, signals and timers ---
+
+typedef struct event_source_t {
+    int fd;
+    int is_timer;
+    int is_oneshot;
+    int always_ready;
+    event_cb_t callback;
+    void* data;
+    struct event_source_t* next;
+} event_source_t;
+
+static int epoll_fd = -1;
+static event_source_t* source_list_head = NULL;
+static int loop_running = 0;
+
+int events_init(void) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("myshell: epoll_create1 error");
+        return -1;
+    }
+    return 0;
+}
+
+static event_source_t* find_source(int fd) {
+    event_source_t* current = source_list_head;
+    while (current != NULL) {
+        if (current->fd == fd) {
+            return current;
+        }
+        current = current->next;
+    }
+    return NULL;
+}
+
+int events_add_fd(int fd, event_cb_t callback, void* data) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    // Regular files (e.g. a script on stdin) cannot be polled; they are
+    // always readable, so the loop simply services them on every pass.
+    int always_ready = 0;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        if (errno != EPERM) {
+            perror("myshell: epoll_ctl error");
+            return -1;
+        }
+        always_ready = 1;
+    }
+
+    event_source_t* source = (event_source_t*)malloc(sizeof(event_source_t));
+    source->fd = fd;
+    source->is_timer = 0;
+    source->is_oneshot = 0;
+    source->always_ready = always_ready;
+    source->callback = callback;
+    source->data = data;
+    source->next = source_list_head;
+    source_list_head = source;
+    return 0;
+}
+
+// Stops watching fd. Timer fds are owned by the loop and closed here.
+void events_remove_fd(int fd) {
+    event_source_t** link = &source_list_head;
+    while (*link != NULL) {
+        event_source_t* source = *link;
+        if (source->fd == fd) {
+            *link = source->next;
+            if (!source->always_ready) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            if (source->is_timer) {
+                close(fd);
+            }
+            free(source);
+            return;
+        }
+        link = &source->next;
+    }
+}
+
+static void ms_to_timespec(long ms, struct timespec* ts) {
+    ts->tv_sec = ms / 1000;
+    ts->tv_nsec = (ms % 1000) * 1000000L;
+}
+
+// Arms a timer that fires after first_ms, then every interval_ms (0 = once).
+// Returns the timer fd, which doubles as the handle for events_remove_fd().
+// One-shot timers are released before their callback runs.
+int events_add_timer(long first_ms, long interval_ms, event_cb_t callback, void* data) {
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0) {
+        perror("myshell: timerfd_create error");
+        return -1;
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    ms_to_timespec(first_ms > 0 ? first_ms : 1, &spec.it_value);
+    ms_to_timespec(interval_ms, &spec.it_interval);
+    if (timerfd_settime(tfd, 0, &spec, NULL) < 0 || events_add_fd(tfd, callback, data) < 0) {
+        perror("myshell: timerfd_settime error");
+        close(tfd);
+        return -1;
+    }
+
+    event_source_t* source = find_source(tfd);
+    source->is_timer = 1;
+    source->is_oneshot = (interval_ms <= 0);
+    return tfd;
+}
+
+static void dispatch(int fd) {
+    // Look the source up again: an earlier callback in the same batch
+    // may have removed it.
+    event_source_t* source = find_source(fd);
+    if (source == NULL) return;
+
+    event_cb_t callback = source->callback;
+    void* data = source->data;
+
+    if (source->is_timer) {
+        uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN) {
+            return;
+        }
+        if (source->is_oneshot) {
+            events_remove_fd(fd);
+        }
+    }
+
+    callback(fd, data);
+}
+
+void events_run(void) {
+    struct epoll_event events[16];
+    int ready[16];
+
+    loop_running = 1;
+    while (loop_running) {
+        int nready = 0;
+        for (event_source_t* source = source_list_head; source != NULL && nready < 16; source = source->next) {
+            if (source->always_ready) ready[nready++] = source->fd;
+        }
+
+        int n = epoll_wait(epoll_fd, events, 16, nready > 0 ? 0 : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("myshell: epoll_wait error");
+            break;
+        }
+        for (int i = 0; i < n && loop_running; i++) {
+            dispatch(events[i].data.fd);
+        }
+        for (int i = 0; i < nready && loop_running; i++) {
+            dispatch(ready[i]);
+        }
+    }
+}
+
+void events_stop(void) {
+    loop_running = 0;
+}
@@ -2,7 +2,6 @@
 
 // Global variables imported from main.c and shell.c
 extern int last_exit_status; 
-extern void add_job(pid_t pid, const char* cmd_line, int is_background);
 extern char* shell_name;
 
 // --- Feature-5: Redirection and Pipe Helpers ---
@@ -37,49 +36,392 @@ void setup_redirection(command_t* cmd) {
     }
 }
 
+// --- Command path cache (like `hash` in other shells) ---
+//
+// Resolved PATH lookups are remembered in the shell process, so forked
+// children can execv() directly. The cache is dropped whenever PATH changes;
+// a stale entry only costs a fallback to execvp() in the child.
+
+#define PATH_CACHE_SIZE 512
+
+typedef struct path_cache_entry_t {
+    char* name;
+    char* path;
+    struct path_cache_entry_t* next;
+} path_cache_entry_t;
+
+static path_cache_entry_t* path_cache[PATH_CACHE_SIZE];
+static char* path_cache_path_var = NULL; // PATH the cache was built from
+
+void clear_path_cache(void) {
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        path_cache_entry_t* entry = path_cache[i];
+        while (entry != NULL) {
+            path_cache_entry_t* next = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+            entry = next;
+        }
+        path_cache[i] = NULL;
+    }
+}
+
+static unsigned path_cache_slot(const char* name) {
+    unsigned hash = 5381;
+    for (; *name; name++) hash = hash * 33 + (unsigned char)*name;
+    return hash % PATH_CACHE_SIZE;
+}
+
+// Returns the cached or newly found executable for name, or NULL if it is
+// not on PATH (or contains a '/', in which case execvp needs no search).
+const char* resolve_command(const char* name) {
+    const char* path_var = getenv("PATH");
+    if (path_var == NULL) path_var = "/usr/local/bin:/usr/bin:/bin";
+    if (strchr(name, '/') != NULL) return NULL;
+
+    if (path_cache_path_var == NULL || strcmp(path_cache_path_var, path_var) != 0) {
+        clear_path_cache();
+        free(path_cache_path_var);
+        path_cache_path_var = strdup(path_var);
+    }
+
+    unsigned slot = path_cache_slot(name);
+    for (path_cache_entry_t* entry = path_cache[slot]; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->name, name) == 0) return entry->path;
+    }
+
+    strbuf_t candidate;
+    sb_init(&candidate);
+    const char* dir = path_var;
+    while (1) {
+        const char* colon = strchr(dir, ':');
+        size_t dir_len = colon ? (size_t)(colon - dir) : strlen(dir);
+
+        sb_clear(&candidate);
+        if (dir_len == 0) {
+            sb_append(&candidate, "."); // Empty PATH element means the current directory
+        } else {
+            sb_append_n(&candidate, dir, dir_len);
+        }
+        sb_append_char(&candidate, '/');
+        sb_append(&candidate, name);
+
+        struct stat st;
+        if (stat(candidate.data, &st) == 0 && S_ISREG(st.st_mode) && access(candidate.data, X_OK) == 0) {
+            path_cache_entry_t* entry = (path_cache_entry_t*)malloc(sizeof(path_cache_entry_t));
+            entry->name = strdup(name);
+            entry->path = sb_detach(&candidate);
+            entry->next = path_cache[slot];
+            path_cache[slot] = entry;
+            return entry->path;
+        }
+
+        if (colon == NULL) break;
+        dir = colon + 1;
+    }
+    sb_free(&candidate);
+    return NULL;
+}
+
+// Lists (or with -r, forgets) the remembered command locations
+void shell_hash(command_t* cmd) {
+    if (cmd->arglist[1] != NULL && strcmp(cmd->arglist[1], "-r") == 0) {
+        clear_path_cache();
+        return;
+    }
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        for (path_cache_entry_t* entry = path_cache[i]; entry != NULL; entry = entry->next) {
+            printf("%s\t%s\n", entry->name, entry->path);
+        }
+    }
+}
+
+// Replaces the child with argv[0], using the path resolved in the parent
+// when there is one. Only returns on failure.
+static void exec_command(char** argv, const char* resolved) {
+    if (resolved != NULL) {
+        execv(resolved, argv);
+    }
+    execvp(argv[0], argv);
+}
+
+// --- `timeout` and `limit` prefixes ---
+//
+//   timeout DURATION COMMAND...   DURATION: 10, 1.5s, 250ms, 2m or 1h
+//   limit [-t CPU_TIME] [-m BYTES] [-n FILES] COMMAND...   CPU_TIME: 10, 10s, 2m or 1h
+//
+// Prefixes may be combined and written on any stage of a pipeline; they
+// apply to every process of the job, the tightest value winning. Limits
+// are set with setrlimit() in each child, never in the shell itself.
+
+static exec_limits_t active_limits; // For the job being started
+
+static void clear_limits(exec_limits_t* limits) {
+    limits->timeout_ms = 0;
+    limits->cpu_seconds = RLIM_INFINITY;
+    limits->address_space = RLIM_INFINITY;
+    limits->open_files = RLIM_INFINITY;
+}
+
+static long parse_duration_ms(const char* text) {
+    char* end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) return -1;
+
+    if (strcmp(end, "ms") == 0) value /= 1000.0;
+    else if (strcmp(end, "m") == 0) value *= 60.0;
+    else if (strcmp(end, "h") == 0) value *= 3600.0;
+    else if (*end != '\0' && strcmp(end, "s") != 0) return -1;
+
+    if (value * 1000.0 > (double)LONG_MAX / 2) return -1;
+    long ms = (long)(value * 1000.0 + 0.5);
+    return ms > 0 ? ms : 1;
+}
+
+// Whole seconds for `limit -t`, with an optional s, m or h suffix
+static long parse_seconds(const char* text) {
+    char* end;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (end == text || value < 0 || errno == ERANGE) return -1;
+
+    long scale = 1;
+    if (strcmp(end, "m") == 0) scale = 60;
+    else if (strcmp(end, "h") == 0) scale = 3600;
+    else if (*end != '\0' && strcmp(end, "s") != 0) return -1;
+
+    if (value > LONG_MAX / scale) return -1;
+    return value * scale;
+}
+
+static void lower_limit(rlim_t* limit, long value) {
+    if (*limit == RLIM_INFINITY || (rlim_t)value < *limit) {
+        *limit = (rlim_t)value;
+    }
+}
+
+// Consumes the prefixes at the start of cmd's arguments into limits.
+// Returns -1 (after printing why) if they are malformed.
+static int strip_exec_prefixes(command_t* cmd, exec_limits_t* limits) {
+    char** args = cmd->arglist;
+    int i = 0;
+
+    while (args[i] != NULL) {
+        if (strcmp(args[i], "timeout") == 0) {
+            long ms = args[i + 1] ? parse_duration_ms(args[i + 1]) : -1;
+            if (ms < 0) {
+                fprintf(stderr, "myshell: usage: timeout DURATION COMMAND...\n");
+                return -1;
+            }
+            if (limits->timeout_ms == 0 || ms < limits->timeout_ms) {
+                limits->timeout_ms = ms;
+            }
+            i += 2;
+        } else if (strcmp(args[i], "limit") == 0) {
+            i++;
+            while (args[i] != NULL && args[i][0] == '-') {
+                int is_time = (strcmp(args[i], "-t") == 0);
+                long value = args[i + 1] ? (is_time ? parse_seconds(args[i + 1]) : parse_size(args[i + 1])) : -1;
+                if (value < 0) {
+                    fprintf(stderr, "myshell: usage: limit [-t CPU_TIME] [-m BYTES] [-n FILES] COMMAND...\n");
+                    return -1;
+                }
+                if (is_time) {
+                    lower_limit(&limits->cpu_seconds, value);
+                } else if (strcmp(args[i], "-m") == 0) {
+                    lower_limit(&limits->address_space, value);
+                } else if (strcmp(args[i], "-n") == 0) {
+                    lower_limit(&limits->open_files, value);
+                } else {
+                    fprintf(stderr, "myshell: limit: %s: unknown limit\n", args[i]);
+                    return -1;
+                }
+                i += 2;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (i > 0 && args[i] == NULL) {
+        fprintf(stderr, "myshell: %s: missing command\n", args[0]);
+        return -1;
+    }
+
+    // Drop the prefix words so the rest runs as an ordinary command
+    for (int j = 0; j < i; j++) {
+        free(args[j]);
+    }
+    int rest = 0;
+    while (args[i + rest] != NULL) rest++;
+    memmove(args, args + i, (rest + 1) * sizeof(char*));
+    return 0;
+}
+
+static void set_limit(int resource, rlim_t soft, rlim_t hard, const char* name) {
+    struct rlimit rl = { soft, hard };
+    if (setrlimit(resource, &rl) < 0) {
+        fprintf(stderr, "myshell: limit: %s: %s\n", name, strerror(errno));
+        exit(125);
+    }
+}
+
+// In the child: applies the limits of the job being started
+static void apply_limits(void) {
+    if (active_limits.cpu_seconds != RLIM_INFINITY) {
+        // SIGXCPU at the soft limit, SIGKILL a second later if it is ignored
+        set_limit(RLIMIT_CPU, active_limits.cpu_seconds, active_limits.cpu_seconds + 1, "CPU time");
+    }
+    if (active_limits.address_space != RLIM_INFINITY) {
+        set_limit(RLIMIT_AS, active_limits.address_space, active_limits.address_space, "address space");
+    }
+    if (active_limits.open_files != RLIM_INFINITY) {
+        set_limit(RLIMIT_NOFILE, active_limits.open_files, active_limits.open_files, "open files");
+    }
+}
+
+// Builds the "cmd args | cmd args" label shown by jobs/fg/bg
+static char* build_job_label(command_t* cmd) {
+    strbuf_t label;
+    sb_init(&label);
+    for (command_t* runner = cmd; runner != NULL; runner = runner->next_pipe) {
+        for (int i = 0; runner->arglist[i] != NULL; i++) {
+            sb_append(&label, runner->arglist[i]);
+            sb_append_char(&label, ' ');
+        }
+        if (runner->next_pipe != NULL) sb_append(&label, "| ");
+    }
+    return sb_detach(&label);
+}
+
+// In the shell: creates the job for cmd, with its timeout attached
+static job_t* start_job(command_t* cmd) {
+    char* cmd_line = build_job_label(cmd);
+    job_t* job = create_job(cmd_line);
+    free(cmd_line);
+
+    // Without job control (scripts, dag tasks, server workers) jobs stay in
+    // the shell's own process group, as in sh, so a Ctrl+C from the terminal
+    // reaches them. They are then signalled and waited for by pid.
+    if (!shell_is_interactive) {
+        job->pgid = getpgrp();
+        job->shared_pgid = 1;
+    }
+    if (active_limits.timeout_ms > 0) {
+        job_set_timeout(job, active_limits.timeout_ms);
+    }
+    job->mem_limited = (active_limits.address_space != RLIM_INFINITY);
+    return job;
+}
+
+// Applies `set -o pipesize` to a new pipe. Failure (e.g. above
+// /proc/sys/fs/pipe-max-size) leaves the kernel default in place.
+static void tune_pipe(int fd) {
+    static int warned = 0;
+
+    if (shell_options.pipe_size <= 0) return;
+    if (fcntl(fd, F_SETPIPE_SZ, shell_options.pipe_size) < 0 && !warned) {
+        perror("myshell: F_SETPIPE_SZ error");
+        warned = 1;
+    }
+}
+
+// Applies `set -o pinning` to the calling pipeline stage. Round-robin walks
+// the CPUs the shell itself may run on.
+static void pin_stage_to_cpu(int stage) {
+    cpu_set_t allowed, target;
+    int cpu = -1;
+
+    if (shell_options.pin_mode == PIN_OFF) return;
+
+    if (shell_options.pin_mode == PIN_LAYOUT) {
+        cpu = shell_options.cpu_layout[stage % shell_options.cpu_layout_len];
+    } else if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        int nth = stage % CPU_COUNT(&allowed);
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &allowed) && nth-- == 0) {
+                cpu = i;
+                break;
+            }
+        }
+    }
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return;
+
+    CPU_ZERO(&target);
+    CPU_SET(cpu, &target);
+    if (sched_setaffinity(0, sizeof(target), &target) < 0) {
+        perror("myshell: sched_setaffinity error");
+    }
+}
+
+// Builtins that run inside a forked stage instead of being exec'd, so they
+// work with pipes, redirection and job control like any other command.
+// Returns the stage's exit status, or -1 if cmd is not one of them.
+int run_stage_builtin(command_t* cmd) {
+    if (strcmp(cmd->arglist[0], "xargs") == 0) {
+        return shell_xargs(cmd);
+    } else if (strcmp(cmd->arglist[0], "cat") == 0) {
+        return shell_cat(cmd);
+    } else if (strcmp(cmd->arglist[0], "tee") == 0) {
+        return shell_tee(cmd);
+    }
+    return -1;
+}
+
+// Feature-9: Places a forked child in its job's process group (pgid 0 starts
+// a new group) and, for foreground jobs, hands it the terminal. Runs before
+// the child's signals are reset so tcsetpgrp() cannot raise SIGTTOU.
+// Without job control the child stays in the shell's group.
+static void enter_job_process_group(pid_t pgid, int is_foreground) {
+    if (!shell_is_interactive) return;
+    setpgid(0, pgid);
+    if (is_foreground) {
+        give_terminal_to(getpgrp(), NULL);
+    }
+}
+
 void execute_simple_command(command_t* cmd) {
-    pid_t pid, wpid;
-    int status;
+    pid_t pid;
+    const char* resolved = resolve_command(cmd->arglist[0]);
 
     pid = fork();
 
     if (pid == 0) {
         // Child process
-        signal(SIGINT, SIG_DFL);
-        
+        enter_job_process_group(0, !cmd->is_background);
+        reset_child_signals();
+        apply_limits();
+
         setup_redirection(cmd);
 
-        if (execvp(cmd->arglist[0], cmd->arglist) == -1) {
-            perror("myshell: execution error");
-            exit(EXIT_FAILURE);
+        int builtin_status = run_stage_builtin(cmd);
+        if (builtin_status >= 0) {
+            exit(builtin_status);
         }
+
+        exec_command(cmd->arglist, resolved);
+        perror("myshell: execution error");
+        exit(EXIT_FAILURE);
     } else if (pid < 0) {
         perror("myshell: fork error");
     } else {
-        // Parent process
+        // Parent process: also set the group here to win the race with the child
+        METRIC_INC(forks);
+        if (shell_is_interactive) {
+            setpgid(pid, pid);
+        }
+
+        job_t* job = start_job(cmd);
+        job_add_process(job, pid);
+
         if (cmd->is_background) {
             // Feature-6 & 9: Background execution
-            printf("[%d] %d\n", 1, pid);
-            
-            char cmd_line[1024] = {0};
-            for (int i = 0; cmd->arglist[i] != NULL; i++) {
-                strcat(cmd_line, cmd->arglist[i]);
-                strcat(cmd_line, " ");
-            }
-            add_job(pid, cmd_line, 1);
-            
+            put_job_in_background(job);
         } else {
-            // Foreground execution (Blocking wait)
-            do {
-                wpid = waitpid(pid, &status, 0);
-            } while (wpid == -1 && errno == EINTR);
-
-            // Feature-7: Update the global exit status
-            if (WIFEXITED(status)) {
-                last_exit_status = WEXITSTATUS(status);
-            } else {
-                last_exit_status = 1; 
-            }
+            // Foreground execution: blocks until the job exits or is stopped
+            // (Feature-7: wait_for_job updates the global exit status)
+            wait_for_job(job);
         }
     }
 }
@@ -87,7 +429,15 @@ void execute_simple_command(command_t* cmd) {
 void execute_piped_command(command_t* cmd) {
     int fd_in = 0;
     command_t* current_cmd = cmd;
-    pid_t last_pid = -1;
+    int is_background = 0;
+    int stage = 0;
+
+    // The parser flags '&' on the final stage of the pipeline
+    for (command_t* runner = cmd; runner != NULL; runner = runner->next_pipe) {
+        is_background = runner->is_background;
+    }
+
+    job_t* job = start_job(cmd);
 
     while (current_cmd != NULL) {
         int pipefd[2];
@@ -95,15 +445,20 @@ void execute_piped_command(command_t* cmd) {
         if (current_cmd->next_pipe != NULL) {
             if (pipe(pipefd) == -1) {
                 perror("myshell: pipe error");
-                return;
+                break;
             }
+            tune_pipe(pipefd[1]);
         }
 
+        const char* resolved = resolve_command(current_cmd->arglist[0]);
         pid_t pid = fork();
 
         if (pid == 0) {
             // Child Process
-            signal(SIGINT, SIG_DFL); 
+            enter_job_process_group(job->pgid, !is_background);
+            reset_child_signals();
+            apply_limits();
+            pin_stage_to_cpu(stage);
 
             // 1. Handle Input
             if (fd_in != 0) {
@@ -121,18 +476,29 @@ void execute_piped_command(command_t* cmd) {
             // 3. Handle Redirection
             setup_redirection(current_cmd);
 
-            // 4. Execute
-            if (execvp(current_cmd->arglist[0], current_cmd->arglist) == -1) {
-                perror("myshell: execution error");
-                exit(EXIT_FAILURE);
+            // 4. Execute (stage builtins run right here, without an exec)
+            int builtin_status = run_stage_builtin(current_cmd);
+            if (builtin_status >= 0) {
+                exit(builtin_status);
             }
+            exec_command(current_cmd->arglist, resolved);
+            perror("myshell: execution error");
+            exit(EXIT_FAILURE);
 
         } else if (pid < 0) {
             perror("myshell: fork error");
-            return;
+            if (current_cmd->next_pipe != NULL) {
+                close(pipefd[0]);
+                close(pipefd[1]);
+            }
+            break;
         } else {
             // Parent Process
-            last_pid = pid;
+            METRIC_INC(forks);
+            job_add_process(job, pid);
+            if (shell_is_interactive) {
+                setpgid(pid, job->pgid);
+            }
 
             if (current_cmd->next_pipe != NULL) {
                 close(pipefd[1]);
@@ -140,54 +506,78 @@ void execute_piped_command(command_t* cmd) {
             
             if (fd_in != 0) {
                 close(fd_in);
+                fd_in = 0;
             }
 
             if (current_cmd->next_pipe != NULL) {
                 fd_in = pipefd[0];
-            } else {
-                // If this is the LAST command in the pipe chain:
-                if (cmd->is_background) {
-                    // Feature-6 & 9: Background execution
-                    printf("[%d] %d\n", 1, last_pid);
-                    
-                    char cmd_line[1024] = {0};
-                    command_t* runner = cmd;
-                    while (runner != NULL) {
-                        for (int i = 0; runner->arglist[i] != NULL; i++) {
-                            strcat(cmd_line, runner->arglist[i]);
-                            strcat(cmd_line, " ");
-                        }
-                        if (runner->next_pipe != NULL) strcat(cmd_line, "| ");
-                        runner = runner->next_pipe;
-                    }
-                    add_job(last_pid, cmd_line, 1);
-
-                } else {
-                    // Foreground execution (Blocking wait for the last PID)
-                    int status;
-                    do {
-                        waitpid(last_pid, &status, 0);
-                    } while (waitpid(last_pid, &status, 0) == -1 && errno == EINTR);
-                    
-                    // Feature-7: Update the global exit status
-                    if (WIFEXITED(status)) {
-                        last_exit_status = WEXITSTATUS(status);
-                    } else {
-                        last_exit_status = 1;
-                    }
-                }
             }
         }
         
         current_cmd = current_cmd->next_pipe;
+        stage++;
+    }
+
+    if (fd_in != 0) {
+        close(fd_in);
+    }
+
+    // Feature-6 & 9: A pipeline is one job, whether it runs in the background
+    // or in the foreground (which also updates the Feature-7 exit status).
+    if (is_background) {
+        put_job_in_background(job);
+    } else {
+        wait_for_job(job);
     }
 }
 
 
+// Feature-6: Runs a command chain and frees it. A link after '&&' runs only
+// if $? is 0, one after '||' only if it is not; skipped links leave $? as is.
+void execute_chain(command_t* head) {
+    command_t* current_chain = head;
+    while (current_chain != NULL) {
+        command_t* next = current_chain->next_chain;
+        current_chain->next_chain = NULL; // Decouple for clean single-command freeing
+
+        int run = 1;
+        if (current_chain->chain_op == CHAIN_AND) {
+            run = (last_exit_status == 0);
+        } else if (current_chain->chain_op == CHAIN_OR) {
+            run = (last_exit_status != 0);
+        }
+
+        if (run && current_chain->arglist != NULL && current_chain->arglist[0] != NULL) {
+            if (!handle_builtin(current_chain)) {
+                execute_command(current_chain);
+            }
+        }
+
+        // Free the command struct that was just executed
+        free_command(current_chain);
+        current_chain = next;
+    }
+}
+
 void execute_command(command_t* cmd) {
+    METRIC_INC(commands_executed);
+
+    clear_limits(&active_limits);
+    for (command_t* stage = cmd; stage != NULL; stage = stage->next_pipe) {
+        if (stage->arglist != NULL && strip_exec_prefixes(stage, &active_limits) < 0) {
+            last_exit_status = 125;
+            return;
+        }
+    }
+
+    // Output of earlier builtins must not be duplicated into (or reordered
+    // after) the children
+    fflush(stdout);
+
     if (cmd->next_pipe == NULL) {
         execute_simple_command(cmd);
     } else {
         execute_piped_command(cmd);
     }
+    clear_limits(&active_limits);
 }
@@ -0,0 +1,376 @@
+#include "shell.h"
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h> // DT_* entry types
+
+// --- Pathname Expansion: '*', '?' and '[...]' ---
+//
+// Directories are read with raw getdents64 in large batches, and entries are
+// matched on the name and d_type alone; stat() is only called when a pattern
+// needs to know whether an entry is a directory and d_type cannot tell, or
+// when a literal component follows a wildcard one.
+
+#define GLOB_DIRENT_BUFFER (1 << 20)
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct glob_list_t {
+    char** items;
+    size_t count;
+    size_t cap;
+} glob_list_t;
+
+// Shared by every scan: a directory is read completely before recursing
+static char* dirent_buffer = NULL;
+
+static void glob_list_push(glob_list_t* list, char* item) {
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 64;
+        list->items = (char**)realloc(list->items, list->cap * sizeof(char*));
+    }
+    list->items[list->count++] = item;
+}
+
+int has_glob_chars(const char* s) {
+    for (; *s != '\0'; s++) {
+        if (*s == '\\' && s[1] != '\0') {
+            s++;
+        } else if (*s == '*' || *s == '?' || *s == '[') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int has_glob_chars_n(const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\\' && i + 1 < len) {
+            i++;
+        } else if (s[i] == '*' || s[i] == '?' || s[i] == '[') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Matches one bracket expression at *pp against c. Advances *pp past the
+// closing ']' and returns 1/0, or -1 if the bracket is unterminated.
+static int match_bracket(const char** pp, const char* end, unsigned char c) {
+    const char* p = *pp + 1;
+    int negate = 0;
+    int matched = 0;
+
+    if (p < end && (*p == '!' || *p == '^')) {
+        negate = 1;
+        p++;
+    }
+    // A ']' right after the opening bracket is a literal member
+    int first = 1;
+    while (p < end && (*p != ']' || first)) {
+        unsigned char lo = (unsigned char)*p;
+        if (lo == '\\' && p + 1 < end) lo = (unsigned char)*++p;
+        p++;
+        unsigned char hi = lo;
+        if (p + 1 < end && *p == '-' && p[1] != ']') {
+            hi = (unsigned char)p[1];
+            if (hi == '\\' && p + 2 < end) {
+                hi = (unsigned char)p[2];
+                p++;
+            }
+            p += 2;
+        }
+        if (c >= lo && c <= hi) matched = 1;
+        first = 0;
+    }
+    if (p >= end) return -1;
+
+    *pp = p + 1;
+    return matched != negate;
+}
+
+// Matches a single path component. Iterative, backtracking only to the last
+// '*', so it runs in linear time for the usual "*.ext" style patterns.
+static int glob_match(const char* pat, size_t pat_len, const char* name) {
+    const char* p = pat;
+    const char* end = pat + pat_len;
+    const char* star_p = NULL;
+    const char* star_n = NULL;
+    const char* n = name;
+
+    while (*n != '\0') {
+        if (p < end) {
+            if (*p == '*') {
+                while (p < end && *p == '*') p++;
+                if (p == end) return 1;
+                star_p = p;
+                star_n = n;
+                continue;
+            }
+            if (*p == '?') {
+                p++;
+                n++;
+                continue;
+            }
+            if (*p == '[') {
+                const char* q = p;
+                int r = match_bracket(&q, end, (unsigned char)*n);
+                if (r == 1) {
+                    p = q;
+                    n++;
+                    continue;
+                }
+                if (r == -1 && *n == '[') { // Unterminated: literal '['
+                    p++;
+                    n++;
+                    continue;
+                }
+            } else {
+                char lit = *p;
+                const char* next = p + 1;
+                if (lit == '\\' && next < end) lit = *next++;
+                if (lit == *n) {
+                    p = next;
+                    n++;
+                    continue;
+                }
+            }
+        }
+        if (star_p == NULL) return 0;
+        p = star_p;
+        n = ++star_n;
+    }
+
+    while (p < end && *p == '*') p++;
+    return p == end;
+}
+
+static int is_directory(const char* dir_path, const char* name, unsigned char d_type) {
+    if (d_type == DT_DIR) return 1;
+    if (d_type != DT_UNKNOWN && d_type != DT_LNK) return 0;
+
+    struct stat st;
+    char* path = (char*)malloc(strlen(dir_path) + strlen(name) + 2);
+    sprintf(path, "%s/%s", dir_path, name);
+    int result = (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+    free(path);
+    return result;
+}
+
+static char* join_path(const char* prefix, size_t prefix_len, const char* name, size_t name_len) {
+    char* path = (char*)malloc(prefix_len + name_len + 1);
+    memcpy(path, prefix, prefix_len);
+    memcpy(path + prefix_len, name, name_len);
+    path[prefix_len + name_len] = '\0';
+    return path;
+}
+
+// prefix is the already-expanded leading part of the path (empty, "/" or
+// ending in '/'); rest is the unexpanded remainder of the pattern.
+static void glob_expand_from(const char* prefix, const char* rest, glob_list_t* out) {
+    size_t prefix_len = strlen(prefix);
+
+    const char* slash = strchr(rest, '/');
+    size_t comp_len = slash ? (size_t)(slash - rest) : strlen(rest);
+
+    // Literal components are copied straight across without a directory scan
+    if (!has_glob_chars_n(rest, comp_len)) {
+        if (slash != NULL) {
+            char* next_prefix = join_path(prefix, prefix_len, rest, comp_len + 1);
+            glob_expand_from(next_prefix, slash + 1, out);
+            free(next_prefix);
+            return;
+        }
+
+        // Literal tail after a wildcard: this is the one place a stat is required
+        char* path = join_path(prefix, prefix_len, rest, comp_len);
+        struct stat st;
+        if (lstat(path, &st) == 0) {
+            glob_list_push(out, path);
+        } else {
+            free(path);
+        }
+        return;
+    }
+
+    int need_dir = (slash != NULL);
+    int match_hidden = (rest[0] == '.');
+
+    const char* dir_path = prefix_len ? prefix : ".";
+    int fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    if (dirent_buffer == NULL) {
+        dirent_buffer = (char*)malloc(GLOB_DIRENT_BUFFER);
+    }
+
+    glob_list_t subdirs = {NULL, 0, 0};
+    long nread;
+    while ((nread = syscall(SYS_getdents64, fd, dirent_buffer, GLOB_DIRENT_BUFFER)) > 0) {
+        for (long off = 0; off < nread;) {
+            struct linux_dirent64* d = (struct linux_dirent64*)(dirent_buffer + off);
+            const char* name = d->d_name;
+            off += d->d_reclen;
+
+            if (name[0] == '.') {
+                if (!match_hidden) continue;
+                if (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')) continue;
+            }
+            if (!glob_match(rest, comp_len, name)) continue;
+            if (need_dir && !is_directory(dir_path, name, d->d_type)) continue;
+
+            size_t name_len = strlen(name);
+            if (need_dir) {
+                glob_list_push(&subdirs, join_path(prefix, prefix_len, name, name_len));
+            } else {
+                glob_list_push(out, join_path(prefix, prefix_len, name, name_len));
+            }
+        }
+    }
+    close(fd);
+
+    for (size_t i = 0; i < subdirs.count; i++) {
+        char* dir = subdirs.items[i];
+        size_t len = strlen(dir);
+        dir = (char*)realloc(dir, len + 2);
+        dir[len] = '/';
+        dir[len + 1] = '\0';
+        glob_expand_from(dir, slash + 1, out);
+        free(dir);
+    }
+    free(subdirs.items);
+}
+
+// --- String sorting: byte order, as with LC_COLLATE=C ---
+
+// Multikey quicksort (Bentley & Sedgewick)
+
+#define CHAR_AT(s, d) ((unsigned char)(s)[d])
+
+static void swap_items(char** a, size_t i, size_t j) {
+    char* t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+}
+
+static void insertion_sort(char** a, size_t n, size_t depth) {
+    for (size_t i = 1; i < n; i++) {
+        for (size_t j = i; j > 0 && strcmp(a[j - 1] + depth, a[j] + depth) > 0; j--) {
+            swap_items(a, j, j - 1);
+        }
+    }
+}
+
+static void multikey_sort(char** a, size_t n, size_t depth) {
+    while (n > 16) {
+        // Partition into <, =, > on the character at depth (Dijkstra 3-way)
+        swap_items(a, 0, n / 2);
+        int pivot = CHAR_AT(a[0], depth);
+        size_t lt = 0, i = 1, gt = n;
+        while (i < gt) {
+            int c = CHAR_AT(a[i], depth);
+            if (c < pivot) {
+                swap_items(a, lt++, i++);
+            } else if (c > pivot) {
+                swap_items(a, i, --gt);
+            } else {
+                i++;
+            }
+        }
+
+        multikey_sort(a, lt, depth);
+        multikey_sort(a + gt, n - gt, depth);
+        if (pivot == 0) return; // The equal block is made of identical strings
+
+        a += lt;
+        n = gt - lt;
+        depth++;
+    }
+    insertion_sort(a, n, depth);
+}
+
+// Large lists are first ordered by an 8-byte big-endian prefix key with an
+// LSD radix sort over contiguous (key, pointer) pairs, which avoids chasing
+// string pointers; only runs sharing a full prefix go to multikey_sort.
+typedef struct sort_item_t {
+    uint64_t key;
+    char* str;
+} sort_item_t;
+
+static void string_sort(char** a, size_t n) {
+    if (n < 1024) {
+        multikey_sort(a, n, 0);
+        return;
+    }
+
+    sort_item_t* items = (sort_item_t*)malloc(n * sizeof(sort_item_t));
+    sort_item_t* tmp = (sort_item_t*)malloc(n * sizeof(sort_item_t));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key = 0;
+        const unsigned char* p = (const unsigned char*)a[i];
+        int b = 0;
+        for (; b < 8 && p[b] != '\0'; b++) key = (key << 8) | p[b];
+        key <<= 8 * (8 - b);
+        items[i].key = key;
+        items[i].str = a[i];
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < n; i++) counts[(items[i].key >> shift) & 0xff]++;
+        if (counts[(items[0].key >> shift) & 0xff] == n) continue; // Byte is the same everywhere
+
+        size_t pos = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[b];
+            counts[b] = pos;
+            pos += c;
+        }
+        for (size_t i = 0; i < n; i++) tmp[counts[(items[i].key >> shift) & 0xff]++] = items[i];
+        sort_item_t* swap = items;
+        items = tmp;
+        tmp = swap;
+    }
+
+    for (size_t i = 0; i < n; i++) a[i] = items[i].str;
+
+    // Equal keys without a terminator in the prefix still need ordering past byte 8
+    for (size_t start = 0; start < n;) {
+        size_t end = start + 1;
+        while (end < n && items[end].key == items[start].key) end++;
+        if (end - start > 1 && (items[start].key & 0xff) != 0) {
+            multikey_sort(a + start, end - start, 8);
+        }
+        start = end;
+    }
+
+    free(items);
+    free(tmp);
+}
+
+// Expands a pattern into a sorted, NULL-terminated array of malloc'd paths.
+// Returns NULL when nothing matches (the caller keeps the word literally).
+char** expand_glob(const char* pattern, size_t* count) {
+    glob_list_t out = {NULL, 0, 0};
+
+    if (pattern[0] == '/') {
+        glob_expand_from("/", pattern + 1, &out);
+    } else {
+        glob_expand_from("", pattern, &out);
+    }
+
+    *count = out.count;
+    if (out.count == 0) {
+        free(out.items);
+        return NULL;
+    }
+
+    string_sort(out.items, out.count);
+    glob_list_push(&out, NULL);
+    return out.items;
+}
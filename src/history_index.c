@@ -0,0 +1,331 @@
+#include "shell.h"
+
+// --- History Search Index ---
+//
+// Every line given to add_to_history_list() is appended here and its
+// (lower-cased) trigrams are added to posting lists. Entry ids only grow, so
+// each posting list is already sorted oldest to newest. A substring query
+// scans only the shortest posting list among its trigrams, newest first,
+// and confirms each candidate with a case-insensitive substring check.
+
+#define HISTORY_INDEX_MAX (1 << 21) // Entries kept before the oldest half is dropped
+
+typedef struct trigram_slot_t {
+    uint32_t key;     // Trigram + 1, so 0 marks an empty slot
+    uint32_t count;
+    uint32_t cap;
+    uint32_t* ids;
+} trigram_slot_t;
+
+static char** entries = NULL;
+static uint32_t entry_count = 0;
+static uint32_t entry_cap = 0;
+static uint32_t first_number = 1; // History number of entries[0]
+
+static trigram_slot_t* slots = NULL;
+static uint32_t slot_mask = 0;
+static uint32_t slot_used = 0;
+
+// Ctrl+R state: the query typed so far, the id on display (entry_count
+// when none) and what to restore on Ctrl+G
+static strbuf_t isearch_query;
+static uint32_t isearch_match = 0;
+static char* isearch_saved_line = NULL;
+static Keymap isearch_keymap = NULL;
+static Keymap isearch_saved_keymap = NULL;
+
+static uint32_t trigram_at(const char* s) {
+    return ((uint32_t)(unsigned char)tolower((unsigned char)s[0]) << 16) |
+           ((uint32_t)(unsigned char)tolower((unsigned char)s[1]) << 8) |
+           (uint32_t)(unsigned char)tolower((unsigned char)s[2]);
+}
+
+static trigram_slot_t* find_slot(uint32_t trigram) {
+    uint32_t key = trigram + 1;
+    uint32_t i = (key * 2654435761u) & slot_mask;
+    while (slots[i].key != 0 && slots[i].key != key) {
+        i = (i + 1) & slot_mask;
+    }
+    return &slots[i];
+}
+
+static void grow_slots(void) {
+    trigram_slot_t* old = slots;
+    uint32_t old_size = slots ? slot_mask + 1 : 0;
+    uint32_t new_size = old_size ? old_size * 2 : 4096;
+
+    slots = (trigram_slot_t*)calloc(new_size, sizeof(trigram_slot_t));
+    slot_mask = new_size - 1;
+    for (uint32_t i = 0; i < old_size; i++) {
+        if (old[i].key != 0) {
+            *find_slot(old[i].key - 1) = old[i];
+        }
+    }
+    free(old);
+}
+
+static void index_entry(uint32_t id) {
+    const char* line = entries[id];
+    size_t len = strlen(line);
+
+    for (size_t i = 0; i + 3 <= len; i++) {
+        if ((slot_used + 1) * 2 > (slots ? slot_mask + 1 : 0)) {
+            grow_slots();
+        }
+
+        uint32_t trigram = trigram_at(line + i);
+        trigram_slot_t* slot = find_slot(trigram);
+        if (slot->key == 0) {
+            slot->key = trigram + 1;
+            slot_used++;
+        }
+        // Repeated trigrams within one line are posted once
+        if (slot->count > 0 && slot->ids[slot->count - 1] == id) continue;
+
+        if (slot->count == slot->cap) {
+            slot->cap = slot->cap ? slot->cap * 2 : 4;
+            slot->ids = (uint32_t*)realloc(slot->ids, slot->cap * sizeof(uint32_t));
+        }
+        slot->ids[slot->count++] = id;
+    }
+}
+
+// Keeps the newest half of the entries and rebuilds the posting lists
+static void compact_index(void) {
+    uint32_t drop = entry_count / 2;
+
+    for (uint32_t i = 0; i < drop; i++) {
+        free(entries[i]);
+    }
+    memmove(entries, entries + drop, (entry_count - drop) * sizeof(char*));
+    entry_count -= drop;
+    first_number += drop;
+
+    for (uint32_t i = 0; slots && i <= slot_mask; i++) {
+        free(slots[i].ids);
+    }
+    free(slots);
+    slots = NULL;
+    slot_used = 0;
+    for (uint32_t id = 0; id < entry_count; id++) {
+        index_entry(id);
+    }
+}
+
+void history_index_add(const char* line) {
+    if (line == NULL || line[0] == '\0') return;
+
+    if (entry_count == HISTORY_INDEX_MAX) {
+        compact_index();
+    }
+    if (entry_count == entry_cap) {
+        entry_cap = entry_cap ? entry_cap * 2 : 1024;
+        entries = (char**)realloc(entries, entry_cap * sizeof(char*));
+    }
+    entries[entry_count] = strdup(line);
+    index_entry(entry_count++);
+}
+
+static int contains_ignore_case(const char* haystack, const char* needle, size_t needle_len) {
+    for (; *haystack != '\0'; haystack++) {
+        if (strncasecmp(haystack, needle, needle_len) == 0) return 1;
+    }
+    return 0;
+}
+
+// Collects up to max ids of entries containing pattern, newest first,
+// considering only ids below before. Returns the number found.
+size_t history_index_search(const char* pattern, uint32_t before, uint32_t* results, size_t max) {
+    size_t found = 0;
+    size_t pattern_len = strlen(pattern);
+    if (before > entry_count) before = entry_count;
+    if (max == 0) return 0;
+
+    if (pattern_len < 3 || slots == NULL) {
+        // Too short to have a trigram: a plain backwards scan
+        for (uint32_t id = before; id-- > 0 && found < max;) {
+            if (contains_ignore_case(entries[id], pattern, pattern_len)) {
+                results[found++] = id;
+            }
+        }
+        return found;
+    }
+
+    // The rarest trigram of the pattern bounds the candidates
+    trigram_slot_t* best = NULL;
+    for (size_t i = 0; i + 3 <= pattern_len; i++) {
+        trigram_slot_t* slot = find_slot(trigram_at(pattern + i));
+        if (slot->key == 0) return 0;
+        if (best == NULL || slot->count < best->count) best = slot;
+    }
+
+    // Skip postings at or after `before` (the lists are sorted by id)
+    uint32_t lo = 0, hi = best->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (best->ids[mid] < before) lo = mid + 1; else hi = mid;
+    }
+
+    for (uint32_t i = lo; i-- > 0 && found < max;) {
+        uint32_t id = best->ids[i];
+        if (contains_ignore_case(entries[id], pattern, pattern_len)) {
+            results[found++] = id;
+        }
+    }
+    return found;
+}
+
+uint32_t history_index_count(void) {
+    return entry_count;
+}
+
+const char* history_index_entry(uint32_t id) {
+    return id < entry_count ? entries[id] : NULL;
+}
+
+// History number shown to the user for an index id
+uint32_t history_index_number(uint32_t id) {
+    return first_number + id;
+}
+
+// Line with the given history number, or NULL once it has been dropped
+const char* history_index_lookup(uint32_t number) {
+    if (number < first_number || number - first_number >= entry_count) return NULL;
+    return entries[number - first_number];
+}
+
+// --- Readline binding: Ctrl+R incremental search over the index ---
+//
+// Ctrl+R switches to a keymap of its own. Each typed character refines the
+// query and shows the newest match; Ctrl+R steps to older matches. Enter
+// runs the match, Esc or Ctrl+J keeps it for editing and Ctrl+G restores
+// the original line. Any other key (arrows included) ends the search and
+// then acts as usual.
+
+static void isearch_show(uint32_t before) {
+    uint32_t id;
+
+    if (history_index_search(isearch_query.data, before, &id, 1) == 1) {
+        isearch_match = id;
+        rl_replace_line(entries[id], 0);
+        rl_point = rl_end;
+    } else {
+        rl_ding();
+    }
+    rl_message("(index-search)`%s': ", isearch_query.data);
+}
+
+static void isearch_finish(void) {
+    rl_set_keymap(isearch_saved_keymap);
+    rl_clear_message();
+    free(isearch_saved_line);
+    isearch_saved_line = NULL;
+}
+
+static int isearch_insert(int count, int key) {
+    (void)count;
+    sb_append_char(&isearch_query, (char)key);
+    // The match on display is kept while it still contains the query
+    isearch_show(isearch_match < entry_count ? isearch_match + 1 : entry_count);
+    return 0;
+}
+
+static int isearch_rubout(int count, int key) {
+    (void)count;
+    (void)key;
+    if (isearch_query.len > 0) {
+        isearch_query.data[--isearch_query.len] = '\0';
+    }
+    isearch_match = entry_count;
+    isearch_show(entry_count);
+    return 0;
+}
+
+static int isearch_older(int count, int key) {
+    (void)count;
+    (void)key;
+    isearch_show(isearch_match);
+    return 0;
+}
+
+static int isearch_abort(int count, int key) {
+    (void)count;
+    (void)key;
+    rl_replace_line(isearch_saved_line, 0);
+    rl_point = rl_end;
+    isearch_finish();
+    return 0;
+}
+
+static int isearch_edit(int count, int key) {
+    (void)count;
+    (void)key;
+    isearch_finish();
+    return 0;
+}
+
+static int isearch_accept(int count, int key) {
+    isearch_finish();
+    return rl_newline(count, key);
+}
+
+// Any other key ends the search and is then handled as usual, so editing
+// keys act on the match
+static int isearch_other(int count, int key) {
+    (void)count;
+    isearch_finish();
+    rl_execute_next(key);
+    return 0;
+}
+
+// A lone Esc ends the search; the start of an escape sequence (an arrow
+// key) ends it too and the sequence goes to the normal keymap
+static int isearch_escape(int count, int key) {
+    struct pollfd pending = { fileno(rl_instream ? rl_instream : stdin), POLLIN, 0 };
+    if (poll(&pending, 1, 50) > 0) {
+        return isearch_other(count, key);
+    }
+    return isearch_edit(count, key);
+}
+
+int history_index_isearch(int count, int key) {
+    (void)count;
+    (void)key;
+
+    if (isearch_keymap == NULL) {
+        isearch_keymap = rl_make_bare_keymap();
+        for (int c = 0; c < KEYMAP_SIZE - 1; c++) {
+            rl_bind_key_in_map(c, (c >= ' ' && c < 127) ? isearch_insert : isearch_other, isearch_keymap);
+        }
+        rl_bind_key_in_map(127, isearch_rubout, isearch_keymap);
+        rl_bind_key_in_map(CTRL('H'), isearch_rubout, isearch_keymap);
+        rl_bind_key_in_map(CTRL('R'), isearch_older, isearch_keymap);
+        rl_bind_key_in_map(CTRL('G'), isearch_abort, isearch_keymap);
+        rl_bind_key_in_map(ESC, isearch_escape, isearch_keymap);
+        rl_bind_key_in_map(CTRL('J'), isearch_edit, isearch_keymap);
+        rl_bind_key_in_map(RETURN, isearch_accept, isearch_keymap);
+    }
+
+    sb_free(&isearch_query);
+    sb_init(&isearch_query);
+    isearch_match = entry_count;
+    isearch_saved_line = strdup(rl_line_buffer);
+    isearch_saved_keymap = rl_get_keymap();
+    rl_set_keymap(isearch_keymap);
+    rl_replace_line("", 0);
+    rl_message("(index-search)`': ");
+    return 0;
+}
+
+void cleanup_history_index(void) {
+    for (uint32_t i = 0; i < entry_count; i++) {
+        free(entries[i]);
+    }
+    free(entries);
+    for (uint32_t i = 0; slots && i <= slot_mask; i++) {
+        free(slots[i].ids);
+    }
+    free(slots);
+    sb_free(&isearch_query);
+    free(isearch_saved_line);
+}
@@ -1,106 +1,269 @@
 #include "shell.h"
 
-// Feature-3 Globals
-char* custom_history_list[HISTORY_SIZE] = {NULL};
-int history_count = 0;
-
-// Feature-6: Handler for SIGCHLD (Zombie Prevention)
-void sigchld_handler(int sig) {
-    // Collect status of all terminated children without blocking
-    // WNOHANG prevents the shell from pausing.
-    while (waitpid(-1, NULL, WNOHANG) > 0);
+// Feature-7: Exit status of the last foreground command ($?)
+int last_exit_status = 0;
+
+// Feature-9: Job control state
+int shell_is_interactive = 0;
+pid_t shell_pgid = 0;
+static struct termios shell_tmodes;
+
+// Event loop state: signals arrive through signalfd instead of handlers,
+// so nothing runs in async-signal context.
+int shell_signal_fd = -1;
+static sigset_t shell_signals;
+static int at_prompt = 0;
+static int serving = 0; // Running as `myshell --serve`
+
+static const char* PROMPT = "myshell> ";
+
+void reset_child_signals(void) {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    sigprocmask(SIG_UNBLOCK, &shell_signals, NULL);
 }
 
-// Feature-6: Handler for SIGINT (Ignore Ctrl+C)
-void sigint_handler(int sig) {
-    // Print a new line and clear the Readline buffer to reset the prompt
-    printf("\n");
-    rl_on_new_line();
-    rl_replace_line("", 0);
-    rl_redisplay();
+void reap_children(void) {
+    pid_t pid;
+    int status;
+
+    // Feature-6: Collect status of all terminated children without blocking.
+    // Stops and continues are reported too so the job table stays current.
+    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
+        if (serving && server_worker_exited(pid, status)) continue;
+        job_reaped(pid, status);
+    }
+    metrics_update_child_cpu();
 }
 
-void setup_environment() {
-    // Feature-4 FIX: Set the custom completion function
-    rl_attempted_completion_function = my_completion;
-    init_history();
+// Prints a message immediately, even while the user is typing: the
+// partially typed line is cleared and redrawn around the message.
+void shell_notify(const char* fmt, ...) {
+    va_list ap;
 
-    // Feature-6: Set up signal handlers
-    signal(SIGCHLD, sigchld_handler); // To reap zombie processes
-    signal(SIGINT, sigint_handler);   // To ignore Ctrl+C in the shell process itself
+    if (at_prompt) {
+        rl_clear_visible_line();
+    }
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    fflush(stdout);
+    if (at_prompt) {
+        rl_forced_update_display();
+    }
 }
 
-void cleanup_resources() {
-    for (int i = 0; i < history_count; i++) {
-        if (custom_history_list[i] != NULL) {
-            free(custom_history_list[i]);
+static void handle_signal_event(int fd, void* data) {
+    struct signalfd_siginfo info;
+    (void)data;
+
+    while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        switch (info.ssi_signo) {
+        case SIGCHLD:
+            reap_children();
+            break;
+        case SIGINT:
+        case SIGTERM:
+            if (serving) { // Shut the server down cleanly
+                events_stop();
+                break;
+            }
+            if (info.ssi_signo == SIGTERM) break; // Interactive shells ignore SIGTERM
+            // Feature-6: Ctrl+C discards the current line instead of killing the shell
+            rl_callback_sigcleanup();
+            printf("\n");
+            rl_replace_line("", 0);
+            rl_on_new_line();
+            rl_redisplay();
+            break;
+        case SIGHUP:
+            if (serving) {
+                events_stop();
+                break;
+            }
+            // The terminal is gone: hang up the jobs and exit through the
+            // normal cleanup so the stats block is removed as well
+            hangup_jobs();
+            cleanup_resources();
+            exit(128 + SIGHUP);
+        case SIGWINCH:
+            rl_resize_terminal();
+            break;
         }
     }
 }
 
-int main(int argc, char** argv) {
-    char* line;
+static void handle_stdin_event(int fd, void* data) {
+    (void)fd;
+    (void)data;
+    rl_callback_read_char();
+}
+
+// Feature-9: Gives the terminal to a job's process group (or back to the
+// shell when pgid is shell_pgid) and restores the matching terminal modes.
+void give_terminal_to(pid_t pgid, const struct termios* modes) {
+    if (!shell_is_interactive) return;
+
+    tcsetpgrp(STDIN_FILENO, pgid);
+    if (pgid == shell_pgid) {
+        tcsetattr(STDIN_FILENO, TCSADRAIN, &shell_tmodes);
+    } else if (modes != NULL) {
+        tcsetattr(STDIN_FILENO, TCSADRAIN, modes);
+    }
+}
+
+static void init_job_control(void) {
+    shell_is_interactive = isatty(STDIN_FILENO);
+    if (!shell_is_interactive) return;
+
+    // Wait until we are in the foreground before taking over the terminal
+    while (tcgetpgrp(STDIN_FILENO) != (shell_pgid = getpgrp())) {
+        kill(-shell_pgid, SIGTTIN);
+    }
+
+    // Ctrl+Z and background terminal access must not stop the shell itself
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGTTIN, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+
+    // Put the shell in its own process group (fails harmlessly for a session leader)
+    setpgid(0, 0);
+    shell_pgid = getpgrp();
+    tcsetpgrp(STDIN_FILENO, shell_pgid);
+    tcgetattr(STDIN_FILENO, &shell_tmodes);
+}
+
+void process_line(char* line) {
     command_t* head_cmd;
-    
-    setup_environment();
 
-    while (1) {
-        line = readline("myshell> ");
+    if (line[0] != '\0') {
+        add_history(line);
+    }
 
-        if (line == NULL) { // EOF (Ctrl+D)
-            printf("exit\n");
-            break;
+    // Feature-3: Handle !n re-execution
+    if (line[0] == '!') {
+        command_t* temp_cmd = parse_command(line);
+        if (temp_cmd != NULL) {
+            reexecute_history(temp_cmd);
+            free_command(temp_cmd);
         }
+        return;
+    }
 
-        if (line[0] != '\0') {
-            add_history(line);
-        }
-        
-        // Feature-3: Handle !n re-execution
-        if (line[0] == '!') {
-            command_t* temp_cmd = parse_command(line);
-            if (temp_cmd != NULL) {
-                reexecute_history(temp_cmd);
-                free_command(temp_cmd);
-                free(line);
-                continue;
-            } else {
-                free(line);
-                continue;
-            }
-        }
-        
-        // Feature-3: Store in our custom history list (for !n)
-        if (line[0] != '\0') {
-            add_to_history_list(line);
-        }
+    // Feature-3: Store in our custom history list (for !n)
+    if (line[0] != '\0') {
+        add_to_history_list(line);
+    }
 
-        // Parse the line into a chained command structure
-        head_cmd = parse_command(line);
-        free(line);
+    // Parse the line into a chained command structure
+    uint64_t parse_start = metrics_now_ns();
+    head_cmd = parse_command_cached(line);
+    METRIC_ADD(parse_time_ns, metrics_now_ns() - parse_start);
+    METRIC_INC(parse_count);
 
-        if (head_cmd == NULL) {
-            continue;
-        }
+    execute_chain(head_cmd);
+}
 
-        // Feature-6: Process the command chain (separated by ';')
-        command_t* current_chain = head_cmd;
-        while (current_chain != NULL) {
-            command_t* next = current_chain->next_chain;
-            current_chain->next_chain = NULL; // Decouple for clean single-command freeing
+static void line_handler(char* line) {
+    if (line == NULL) { // EOF (Ctrl+D)
+        printf("exit\n");
+        rl_callback_handler_remove();
+        events_stop();
+        return;
+    }
 
-            if (current_chain->arglist != NULL && current_chain->arglist[0] != NULL) {
-                if (!handle_builtin(current_chain)) {
-                    execute_command(current_chain);
-                }
-            }
+    at_prompt = 0;
+    metrics_set_command(line);
+    process_line(line);
+    metrics_set_command("");
+    free(line);
+    at_prompt = 1;
+}
 
-            // Free the command struct that was just executed
-            free_command(current_chain);
-            current_chain = next;
+void setup_environment() {
+    // Feature-4 FIX: Set the custom completion function
+    rl_attempted_completion_function = my_completion;
+    rl_add_defun("history-index-search", history_index_isearch, CTRL('R'));
+    metrics_init();
+
+    // Signals are read from the event loop, so readline must not install
+    // its own handlers.
+    rl_catch_signals = 0;
+    rl_catch_sigwinch = 0;
+
+    // Feature-6: SIGCHLD reaps zombies, SIGINT is ignored by the shell itself
+    sigemptyset(&shell_signals);
+    sigaddset(&shell_signals, SIGCHLD);
+    sigaddset(&shell_signals, SIGINT);
+    sigaddset(&shell_signals, SIGWINCH);
+    sigaddset(&shell_signals, SIGTERM);
+    sigaddset(&shell_signals, SIGHUP);
+    sigprocmask(SIG_BLOCK, &shell_signals, NULL);
+
+    shell_signal_fd = signalfd(-1, &shell_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (shell_signal_fd < 0) {
+        perror("myshell: signalfd error");
+        exit(EXIT_FAILURE);
+    }
+
+    if (events_init() < 0 || events_add_fd(shell_signal_fd, handle_signal_event, NULL) < 0) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+void cleanup_resources() {
+    cleanup_job_list();
+    cleanup_history_index();
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: myshell [--norc] [--serve SOCKET [--workers N]]\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    const char* serve_path = NULL;
+    int workers = 0;
+    int read_rc = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (strcmp(argv[i], "--norc") == 0) {
+            read_rc = 0;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            workers = atoi(argv[++i]);
+        } else {
+            usage();
         }
     }
 
+    setup_environment();
+    if (serve_path == NULL) {
+        init_job_control(); // Before the rc file, so its commands get the terminal
+    }
+    init_shell_vars();
+    if (read_rc) {
+        load_rc_file();
+    }
+
+    if (serve_path != NULL) {
+        // No terminal and no prompt: requests arrive on the socket
+        serving = 1;
+        int status = run_server(serve_path, workers);
+        cleanup_resources();
+        return status < 0 ? EXIT_FAILURE : 0;
+    }
+
+    if (events_add_fd(STDIN_FILENO, handle_stdin_event, NULL) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    rl_callback_handler_install(PROMPT, line_handler);
+    at_prompt = 1;
+    events_run();
+
     cleanup_resources();
     return 0;
 }
@@ -0,0 +1,96 @@
+#include "shell.h"
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// --- Shared-memory live metrics (see include/metrics.h) ---
+
+// Falls back to a private block when /dev/shm is unavailable, so the
+// METRIC_* macros never need a NULL check.
+static shell_stats_t private_stats;
+shell_stats_t* shell_stats = &private_stats;
+
+static char* stats_path = NULL;
+
+void metrics_init(void) {
+    strbuf_t path;
+    char pid_str[16];
+
+    snprintf(pid_str, sizeof(pid_str), "%d", (int)getpid());
+    sb_init(&path);
+    sb_append(&path, SHELL_STATS_DIR "/" SHELL_STATS_PREFIX);
+    sb_append(&path, pid_str);
+    sb_append(&path, SHELL_STATS_SUFFIX);
+
+    // The name is predictable and the block holds command lines: create it
+    // private and fresh, never through a link or someone else's file. A
+    // stale block of ours (a reused pid) is removed first.
+    struct stat st;
+    if (lstat(path.data, &st) == 0 && st.st_uid == geteuid()) {
+        unlink(path.data);
+    }
+    int fd = open(path.data, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0 || ftruncate(fd, sizeof(shell_stats_t)) < 0) {
+        if (fd >= 0) close(fd);
+        sb_free(&path);
+        return;
+    }
+
+    void* block = mmap(NULL, sizeof(shell_stats_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (block == MAP_FAILED) {
+        unlink(path.data);
+        sb_free(&path);
+        return;
+    }
+
+    shell_stats = (shell_stats_t*)block;
+    shell_stats->pid = (int32_t)getpid();
+    shell_stats->size = sizeof(shell_stats_t);
+    shell_stats->start_time = (uint64_t)time(NULL);
+    shell_stats->version = SHELL_STATS_VERSION;
+    // Readers ignore the block until the magic is visible
+    __atomic_store_n(&shell_stats->magic, SHELL_STATS_MAGIC, __ATOMIC_RELEASE);
+
+    stats_path = sb_detach(&path);
+    atexit(metrics_cleanup); // Also covers the exit builtin
+}
+
+void metrics_cleanup(void) {
+    if (stats_path == NULL) return;
+
+    // Forked children share the mapping but must not remove the file
+    if (shell_stats->pid == (int32_t)getpid()) {
+        unlink(stats_path);
+    }
+    free(stats_path);
+    stats_path = NULL;
+}
+
+void metrics_set_command(const char* line) {
+    uint64_t seq = __atomic_load_n(&shell_stats->command_seq, __ATOMIC_RELAXED);
+    size_t len = strlen(line);
+    if (len >= SHELL_STATS_CMD_MAX) len = SHELL_STATS_CMD_MAX - 1;
+
+    __atomic_store_n(&shell_stats->command_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(shell_stats->current_command, line, len);
+    shell_stats->current_command[len] = '\0';
+    __atomic_store_n(&shell_stats->command_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Refreshes the CPU time of every child the shell has waited for
+void metrics_update_child_cpu(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_CHILDREN, &usage) < 0) return;
+
+    uint64_t us = (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+                  (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+    METRIC_SET(child_cpu_us, us);
+}
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,468 @@
+#include "shell.h"
+
+#include <sys/mman.h>
+
+// --- Startup file (~/.myshellrc) and its compiled snapshot ---
+//
+// The rc file is run line by line as if typed at the prompt. While it runs
+// the result is recorded in ~/.myshellrc.snap, in the order it happened:
+//   - after each line, the variables it set, so assignments never need
+//     re-parsing;
+//   - every other line as its parsed command structure (variables already
+//     substituted), to be executed again on each start;
+//   - lines with wildcards or $? as raw text, since their expansion depends
+//     on the filesystem or earlier exit statuses. These are re-parsed on
+//     each start and see the variables as they were at that point.
+// On later starts the snapshot is mapped and replayed instead. It is used
+// while the rc file's mtime and size are unchanged; otherwise the file is
+// hashed, and only a changed hash means the rc file is run again.
+
+#define RC_FILE_NAME ".myshellrc"
+#define RC_SNAPSHOT_SUFFIX ".snap"
+#define RC_SNAPSHOT_MAGIC 0x4352534du // "MSRC"
+#define RC_SNAPSHOT_VERSION 2
+
+enum { RC_RECORD_VAR = 1, RC_RECORD_COMMAND = 2, RC_RECORD_RAW = 3 };
+
+#define RC_NO_STRING 0xffffffffu
+
+typedef struct rc_snapshot_header_t {
+    uint32_t magic;
+    uint32_t version;
+    int64_t rc_mtime_sec;
+    int64_t rc_mtime_nsec;
+    uint64_t rc_size;
+    uint64_t rc_hash;      // FNV-1a of the rc file contents
+    uint64_t total_size;   // Header included
+    uint32_t record_count;
+    uint32_t reserved;
+} rc_snapshot_header_t;
+
+// Bounds-checked cursor over the mapped snapshot
+typedef struct rc_reader_t {
+    const char* pos;
+    const char* end;
+    int bad;
+} rc_reader_t;
+
+static uint64_t hash_bytes(const char* data, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// --- Writing ---
+
+static void put_u32(strbuf_t* out, uint32_t value) {
+    sb_append_n(out, (const char*)&value, sizeof(value));
+}
+
+static void put_string(strbuf_t* out, const char* s) {
+    if (s == NULL) {
+        put_u32(out, RC_NO_STRING);
+        return;
+    }
+    uint32_t len = (uint32_t)strlen(s);
+    put_u32(out, len);
+    sb_append_n(out, s, len + 1); // NUL included
+}
+
+static void put_command(strbuf_t* out, const command_t* cmd) {
+    uint32_t argc = 0;
+    while (cmd->arglist != NULL && cmd->arglist[argc] != NULL) argc++;
+
+    put_u32(out, argc);
+    for (uint32_t i = 0; i < argc; i++) {
+        put_string(out, cmd->arglist[i]);
+    }
+    put_string(out, cmd->input_file);
+    put_string(out, cmd->output_file);
+    sb_append_char(out, (char)cmd->is_background);
+    sb_append_char(out, (char)cmd->chain_op);
+
+    sb_append_char(out, cmd->next_pipe != NULL);
+    if (cmd->next_pipe != NULL) put_command(out, cmd->next_pipe);
+    sb_append_char(out, cmd->next_chain != NULL);
+    if (cmd->next_chain != NULL) put_command(out, cmd->next_chain);
+}
+
+static void put_record(strbuf_t* out, uint32_t type, const strbuf_t* payload, uint32_t* record_count) {
+    put_u32(out, type);
+    put_u32(out, (uint32_t)payload->len);
+    sb_append_n(out, payload->data ? payload->data : "", payload->len);
+    (*record_count)++;
+}
+
+// Variable values as last recorded, so each line records only what it changed
+typedef struct rc_recorded_var_t {
+    char* name;
+    char* value;
+    struct rc_recorded_var_t* next;
+} rc_recorded_var_t;
+
+typedef struct rc_recorder_t {
+    strbuf_t* out; // NULL only notes the current values
+
+    uint32_t* record_count;
+    rc_recorded_var_t* vars;
+} rc_recorder_t;
+
+static void record_var_if_changed(const char* name, const char* value, void* data) {
+    rc_recorder_t* recorder = (rc_recorder_t*)data;
+    rc_recorded_var_t* var = recorder->vars;
+    while (var != NULL && strcmp(var->name, name) != 0) var = var->next;
+
+    if (var == NULL) {
+        var = (rc_recorded_var_t*)malloc(sizeof(rc_recorded_var_t));
+        var->name = strdup(name);
+        var->value = NULL;
+        var->next = recorder->vars;
+        recorder->vars = var;
+    } else if (strcmp(var->value, value) == 0) {
+        return;
+    }
+    free(var->value);
+    var->value = strdup(value);
+    if (recorder->out == NULL) return;
+
+    strbuf_t payload;
+    sb_init(&payload);
+    put_string(&payload, name);
+    put_string(&payload, value);
+    put_record(recorder->out, RC_RECORD_VAR, &payload, recorder->record_count);
+    sb_free(&payload);
+}
+
+// Records every variable set since the last call
+static void record_var_changes(rc_recorder_t* recorder) {
+    foreach_shell_var(record_var_if_changed, recorder);
+}
+
+static void free_recorded_vars(rc_recorder_t* recorder) {
+    while (recorder->vars != NULL) {
+        rc_recorded_var_t* next = recorder->vars->next;
+        free(recorder->vars->name);
+        free(recorder->vars->value);
+        free(recorder->vars);
+        recorder->vars = next;
+    }
+}
+
+// --- Reading ---
+
+static uint32_t get_u32(rc_reader_t* r) {
+    uint32_t value = 0;
+    if (r->bad || (size_t)(r->end - r->pos) < sizeof(value)) {
+        r->bad = 1;
+        return 0;
+    }
+    memcpy(&value, r->pos, sizeof(value));
+    r->pos += sizeof(value);
+    return value;
+}
+
+static int get_byte(rc_reader_t* r) {
+    if (r->bad || r->pos >= r->end) {
+        r->bad = 1;
+        return 0;
+    }
+    return (unsigned char)*r->pos++;
+}
+
+// Returns a pointer into the mapping (NUL terminated), or NULL
+static const char* get_string(rc_reader_t* r) {
+    uint32_t len = get_u32(r);
+    if (r->bad || len == RC_NO_STRING) return NULL;
+    if ((size_t)(r->end - r->pos) <= len || r->pos[len] != '\0') {
+        r->bad = 1;
+        return NULL;
+    }
+    const char* s = r->pos;
+    r->pos += len + 1;
+    return s;
+}
+
+static command_t* get_command(rc_reader_t* r, int depth) {
+    if (depth > 4096) { // Guards the recursion against a corrupt file
+        r->bad = 1;
+        return NULL;
+    }
+
+    command_t* cmd = (command_t*)calloc(1, sizeof(command_t));
+    uint32_t argc = get_u32(r);
+    if (r->bad || argc > (uint32_t)(r->end - r->pos)) {
+        r->bad = 1;
+        free(cmd);
+        return NULL;
+    }
+    if (argc > 0) {
+        cmd->arglist = (char**)calloc(argc + 1, sizeof(char*));
+        for (uint32_t i = 0; i < argc; i++) {
+            const char* arg = get_string(r);
+            cmd->arglist[i] = strdup(arg ? arg : "");
+        }
+    }
+    const char* input = get_string(r);
+    const char* output = get_string(r);
+    cmd->input_file = input ? strdup(input) : NULL;
+    cmd->output_file = output ? strdup(output) : NULL;
+    cmd->is_background = get_byte(r);
+    cmd->chain_op = get_byte(r);
+
+    if (get_byte(r)) cmd->next_pipe = get_command(r, depth + 1);
+    if (get_byte(r)) cmd->next_chain = get_command(r, depth + 1);
+    return cmd;
+}
+
+// --- Running the rc file ---
+
+// A line that only assigns variables needs nothing from the snapshot but
+// the final variable table
+static int is_assignment_only(const command_t* head) {
+    for (const command_t* link = head; link != NULL; link = link->next_chain) {
+        if (link->next_pipe != NULL || link->arglist == NULL || link->arglist[0] == NULL) return 0;
+        const char* equals = strchr(link->arglist[0], '=');
+        if (equals == NULL || equals == link->arglist[0]) return 0;
+    }
+    return 1;
+}
+
+static void run_line(char* line) {
+    command_t* head = parse_command(line);
+    if (head != NULL) execute_chain(head);
+}
+
+// Runs the rc file from scratch, appending its records to out
+static void run_rc_file(char* contents, strbuf_t* out, uint32_t* record_count) {
+    strbuf_t payload;
+    sb_init(&payload);
+
+    // Variables that exist before the file runs are set on every start anyway
+    rc_recorder_t recorder = { NULL, record_count, NULL };
+    record_var_changes(&recorder);
+    recorder.out = out;
+
+    char* saveptr = NULL;
+    for (char* line = strtok_r(contents, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr)) {
+        while (isspace((unsigned char)*line)) line++;
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        sb_clear(&payload);
+        if (has_glob_chars(line) || strstr(line, "$?") != NULL) {
+            put_string(&payload, line);
+            put_record(out, RC_RECORD_RAW, &payload, record_count);
+            run_line(line);
+            record_var_changes(&recorder);
+            continue;
+        }
+
+        command_t* head = parse_command(line);
+        if (head == NULL) continue;
+        if (!is_assignment_only(head)) {
+            put_command(&payload, head);
+            put_record(out, RC_RECORD_COMMAND, &payload, record_count);
+        }
+        execute_chain(head);
+        record_var_changes(&recorder);
+    }
+
+    free_recorded_vars(&recorder);
+    sb_free(&payload);
+}
+
+static void write_snapshot(const char* snap_path, const rc_snapshot_header_t* header, const strbuf_t* body) {
+    strbuf_t tmp_path;
+    sb_init(&tmp_path);
+    sb_append(&tmp_path, snap_path);
+    sb_append(&tmp_path, ".tmp");
+
+    // Written aside and renamed, so a concurrent start never maps a partial file
+    int fd = open(tmp_path.data, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        int ok = write(fd, header, sizeof(*header)) == (ssize_t)sizeof(*header) &&
+                 (body->len == 0 || write(fd, body->data, body->len) == (ssize_t)body->len);
+        close(fd);
+        if (!ok || rename(tmp_path.data, snap_path) < 0) {
+            unlink(tmp_path.data);
+        }
+    }
+    sb_free(&tmp_path);
+}
+
+// Replays a mapped snapshot. Returns -1, having run nothing, if it is malformed.
+static int replay_snapshot(const char* map, size_t size) {
+    const rc_snapshot_header_t* header = (const rc_snapshot_header_t*)map;
+    rc_reader_t r = { map + sizeof(*header), map + size, 0 };
+
+    // Check every record before acting on any of them
+    for (uint32_t i = 0; i < header->record_count && !r.bad; i++) {
+        get_u32(&r);
+        uint32_t len = get_u32(&r);
+        if (r.bad || len > (size_t)(r.end - r.pos)) return -1;
+        r.pos += len;
+    }
+    if (r.bad || r.pos != r.end) return -1;
+
+    r.pos = map + sizeof(*header);
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        uint32_t type = get_u32(&r);
+        uint32_t len = get_u32(&r);
+        rc_reader_t record = { r.pos, r.pos + len, 0 };
+        r.pos += len;
+
+        if (type == RC_RECORD_VAR) {
+            const char* name = get_string(&record);
+            const char* value = get_string(&record);
+            if (!record.bad && name != NULL && value != NULL) set_shell_var(name, value);
+        } else if (type == RC_RECORD_COMMAND) {
+            command_t* head = get_command(&record, 0);
+            if (record.bad) {
+                free_command_chain(head);
+            } else {
+                execute_chain(head);
+            }
+        } else if (type == RC_RECORD_RAW) {
+            const char* line = get_string(&record);
+            if (!record.bad && line != NULL) {
+                char* copy = strdup(line);
+                run_line(copy);
+                free(copy);
+            }
+        }
+    }
+    return 0;
+}
+
+// Maps and replays the snapshot if it still matches the rc file.
+// contents is read (and hashed) only when the mtime check fails.
+static int load_snapshot(const char* snap_path, const char* rc_path, const struct stat* rc_st) {
+    int fd = open(snap_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(rc_snapshot_header_t)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    rc_snapshot_header_t header;
+    memcpy(&header, map, sizeof(header));
+    int valid = header.magic == RC_SNAPSHOT_MAGIC && header.version == RC_SNAPSHOT_VERSION &&
+                header.total_size == size && header.rc_size == (uint64_t)rc_st->st_size;
+
+    if (valid && (header.rc_mtime_sec != (int64_t)rc_st->st_mtim.tv_sec ||
+                  header.rc_mtime_nsec != (int64_t)rc_st->st_mtim.tv_nsec)) {
+        // Touched but perhaps not changed: compare contents by hash
+        valid = 0;
+        int rc_fd = open(rc_path, O_RDONLY | O_CLOEXEC);
+        if (rc_fd >= 0) {
+            char* rc_map = rc_st->st_size > 0 ? mmap(NULL, rc_st->st_size, PROT_READ, MAP_PRIVATE, rc_fd, 0) : NULL;
+            if (rc_map != MAP_FAILED) {
+                valid = hash_bytes(rc_map, rc_st->st_size) == header.rc_hash;
+                if (rc_map != NULL) munmap(rc_map, rc_st->st_size);
+            }
+            close(rc_fd);
+        }
+        if (valid) { // A fresh copy with the new mtime lets the next start skip the hash
+            strbuf_t body = { map + sizeof(header), size - sizeof(header), 0 };
+            header.rc_mtime_sec = (int64_t)rc_st->st_mtim.tv_sec;
+            header.rc_mtime_nsec = (int64_t)rc_st->st_mtim.tv_nsec;
+            write_snapshot(snap_path, &header, &body);
+        }
+    }
+    close(fd);
+
+    int status = valid ? replay_snapshot(map, size) : -1;
+    munmap(map, size);
+    return status;
+}
+
+// Variables every shell starts with, before any rc file
+void init_shell_vars(void) {
+    set_shell_var("SHELL", MYSHELL_PATH);
+    set_shell_var("VERSION", MYSHELL_VERSION);
+}
+
+// Runs $MYSHELLRC, or ~/.myshellrc, preferring its snapshot when current
+void load_rc_file(void) {
+    strbuf_t rc_path;
+    sb_init(&rc_path);
+    const char* override = getenv("MYSHELLRC");
+    const char* home = getenv("HOME");
+    if (override != NULL && override[0] != '\0') {
+        sb_append(&rc_path, override);
+    } else if (home != NULL) {
+        sb_append(&rc_path, home);
+        sb_append(&rc_path, "/" RC_FILE_NAME);
+    } else {
+        sb_free(&rc_path);
+        return;
+    }
+
+    struct stat rc_st;
+    if (stat(rc_path.data, &rc_st) < 0 || !S_ISREG(rc_st.st_mode)) {
+        sb_free(&rc_path);
+        return;
+    }
+
+    strbuf_t snap_path;
+    sb_init(&snap_path);
+    sb_append(&snap_path, rc_path.data);
+    sb_append(&snap_path, RC_SNAPSHOT_SUFFIX);
+
+    if (load_snapshot(snap_path.data, rc_path.data, &rc_st) == 0) {
+        sb_free(&snap_path);
+        sb_free(&rc_path);
+        return;
+    }
+
+    // Cold start: run the file itself and record what it did
+    FILE* rc = fopen(rc_path.data, "r");
+    if (rc == NULL) {
+        sb_free(&snap_path);
+        sb_free(&rc_path);
+        return;
+    }
+    strbuf_t contents;
+    sb_init(&contents);
+    char chunk[64 * 1024];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), rc)) > 0) {
+        sb_append_n(&contents, chunk, n);
+    }
+    fclose(rc);
+
+    rc_snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RC_SNAPSHOT_MAGIC;
+    header.version = RC_SNAPSHOT_VERSION;
+    header.rc_mtime_sec = (int64_t)rc_st.st_mtim.tv_sec;
+    header.rc_mtime_nsec = (int64_t)rc_st.st_mtim.tv_nsec;
+    header.rc_size = contents.len;
+    header.rc_hash = hash_bytes(contents.data ? contents.data : "", contents.len);
+
+    strbuf_t body;
+    sb_init(&body);
+    if (contents.len > 0) {
+        run_rc_file(contents.data, &body, &header.record_count);
+    }
+    header.total_size = sizeof(header) + body.len;
+
+    // A file that changed while it was being read must not be cached
+    if (header.rc_size == (uint64_t)rc_st.st_size) {
+        write_snapshot(snap_path.data, &header, &body);
+    }
+
+    sb_free(&body);
+    sb_free(&contents);
+    sb_free(&snap_path);
+    sb_free(&rc_path);
+}
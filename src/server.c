@@ -0,0 +1,423 @@
+#include "shell.h"
+#include "server.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Global variables imported from main.c
+extern int last_exit_status;
+
+// --- Server mode: `myshell --serve SOCKET [--workers N]` ---
+//
+// One long-lived shell keeps its variables, PATH cache and parse cache warm
+// and runs command lines sent by local clients. Requests are read without
+// blocking, so a stalled client only holds its own slot until it times out.
+// Once a request is complete the shell forks a worker that takes over the
+// client's stdin/stdout/stderr, enters the client's working directory and
+// runs the line. Lines whose parse runs nothing (no if block, variables or
+// globs) are parsed here first, so the caches fill in this process; all
+// others are parsed by the worker, where an if condition sees the client's
+// descriptors and directory. State changes made by a line (cd, variables)
+// stay in its worker. When a worker is reaped the shell sends its exit
+// status back and closes the connection.
+// The socket is created mode 0600 and clients running as another user are
+// turned away, since a request runs commands as the server's user.
+// At most max_workers requests are read or run at once; beyond that the
+// listening socket is left out of the event loop and new clients wait in
+// its backlog.
+
+#define SERVER_BACKLOG 128
+#define SERVER_REQUEST_TIMEOUT_MS 5000 // A client that stalls mid-request is dropped
+
+// A connection whose request is still arriving
+typedef struct server_conn_t {
+    int fd;
+    int timer_fd;
+    server_request_t header;
+    size_t header_got;
+    int fds[SERVER_NFDS];
+    int nfds;
+    char* payload; // The line, then the cwd, each NUL-terminated
+    size_t payload_len;
+    size_t payload_got;
+} server_conn_t;
+
+typedef struct server_worker_t {
+    pid_t pid;
+    int conn_fd;
+    struct server_worker_t* next;
+} server_worker_t;
+
+static int listen_fd = -1;
+static int listening = 0;
+static const char* socket_path = NULL;
+static server_worker_t* worker_list_head = NULL;
+static int active_workers = 0; // Connections being read count too
+static int max_workers = 1;
+
+static void handle_connection(int fd, void* data);
+
+static void set_listening(int on) {
+    if (on && !listening) {
+        listening = (events_add_fd(listen_fd, handle_connection, NULL) == 0);
+    } else if (!on && listening) {
+        events_remove_fd(listen_fd);
+        listening = 0;
+    }
+}
+
+static void release_slot(void) {
+    if (--active_workers < max_workers && listen_fd >= 0) {
+        set_listening(1);
+    }
+}
+
+static void send_reply(int conn_fd, int status) {
+    server_reply_t reply;
+    reply.magic = SERVER_MAGIC;
+    reply.status = status;
+    // The client may already be gone; MSG_NOSIGNAL keeps that from raising SIGPIPE
+    send(conn_fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+}
+
+// Releases a connection that will not run, closing the client's descriptors
+static void drop_connection(server_conn_t* conn) {
+    events_remove_fd(conn->fd);
+    if (conn->timer_fd >= 0) events_remove_fd(conn->timer_fd);
+    close(conn->fd);
+    for (int i = 0; i < conn->nfds; i++) close(conn->fds[i]);
+    free(conn->payload);
+    free(conn);
+    release_slot();
+}
+
+static void request_timed_out(int fd, void* data) {
+    server_conn_t* conn = (server_conn_t*)data;
+    (void)fd;
+    conn->timer_fd = -1; // One-shot timers are released by the loop
+    drop_connection(conn);
+}
+
+static void take_fds(server_conn_t* conn, struct msghdr* msg) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            int* received = (int*)CMSG_DATA(cmsg);
+            for (int i = 0; i < count; i++) {
+                if (conn->nfds < SERVER_NFDS) {
+                    conn->fds[conn->nfds++] = received[i];
+                } else {
+                    close(received[i]);
+                }
+            }
+        }
+    }
+}
+
+// Reads what has arrived of the request. Returns 1 once it is complete,
+// 0 if more is needed and -1 if the request is bad or the client left.
+static int read_request(server_conn_t* conn) {
+    while (conn->header_got < sizeof(conn->header)) {
+        char control[CMSG_SPACE(SERVER_NFDS * sizeof(int))];
+        struct iovec iov = { (char*)&conn->header + conn->header_got, sizeof(conn->header) - conn->header_got };
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(conn->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+        if (n < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+        if (n == 0) return -1;
+        take_fds(conn, &msg);
+        if (msg.msg_flags & MSG_CTRUNC) return -1;
+        conn->header_got += (size_t)n;
+
+        if (conn->header_got == sizeof(conn->header)) {
+            if (conn->header.magic != SERVER_MAGIC || conn->header.line_len > SERVER_LINE_MAX ||
+                conn->header.cwd_len >= PATH_MAX || conn->nfds != SERVER_NFDS) {
+                return -1;
+            }
+            conn->payload_len = (size_t)conn->header.line_len + conn->header.cwd_len;
+            conn->payload = (char*)malloc(conn->payload_len + 2);
+        }
+    }
+
+    while (conn->payload_got < conn->payload_len) {
+        ssize_t n = recv(conn->fd, conn->payload + conn->payload_got,
+                         conn->payload_len - conn->payload_got, MSG_DONTWAIT);
+        if (n < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+        if (n == 0) return -1;
+        conn->payload_got += (size_t)n;
+    }
+
+    // Split into two strings: line NUL cwd NUL
+    size_t line_len = conn->header.line_len;
+    memmove(conn->payload + line_len + 1, conn->payload + line_len, conn->header.cwd_len);
+    conn->payload[line_len] = '\0';
+    conn->payload[conn->payload_len + 1] = '\0';
+    return 1;
+}
+
+// Resolves every stage's command now, so the cache entry lands in the
+// long-lived shell rather than in a worker that is about to exit.
+static void warm_path_cache(command_t* head) {
+    for (command_t* chain = head; chain != NULL; chain = chain->next_chain) {
+        for (command_t* stage = chain; stage != NULL; stage = stage->next_pipe) {
+            if (stage->arglist != NULL && stage->arglist[0] != NULL) {
+                resolve_command(stage->arglist[0]);
+            }
+        }
+    }
+}
+
+// Parses a cacheable line in the server. Its only output is a syntax error,
+// which belongs on the client's stderr, and the status it leaves ($? = 2)
+// belongs to the worker. Returns that status.
+static int parse_in_server(server_conn_t* conn, const char* line, command_t** head) {
+    int saved_status = last_exit_status;
+    int saved_stderr = dup(STDERR_FILENO);
+
+    fflush(stderr);
+    dup2(conn->fds[STDERR_FILENO], STDERR_FILENO);
+    last_exit_status = 0;
+
+    uint64_t parse_start = metrics_now_ns();
+    *head = parse_command_cached((char*)line);
+    METRIC_ADD(parse_time_ns, metrics_now_ns() - parse_start);
+    METRIC_INC(parse_count);
+
+    int status = last_exit_status;
+    last_exit_status = saved_status;
+    fflush(stderr);
+    if (saved_stderr >= 0) {
+        dup2(saved_stderr, STDERR_FILENO);
+        close(saved_stderr);
+    }
+    return status;
+}
+
+static void run_worker(server_conn_t* conn, command_t* head, int parsed, int parse_status) {
+    const char* line = conn->payload;
+    const char* cwd = conn->payload + conn->header.line_len + 1;
+
+    reset_child_signals();
+    close(listen_fd);
+    close(conn->fd);
+
+    for (int i = 0; i < SERVER_NFDS; i++) {
+        if (dup2(conn->fds[i], i) < 0) {
+            perror("myshell: dup2 error");
+            exit(EXIT_FAILURE);
+        }
+        close(conn->fds[i]);
+    }
+    if (cwd[0] != '\0' && chdir(cwd) < 0) {
+        fprintf(stderr, "myshell: cd: %s: %s\n", cwd, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if (!parsed) {
+        head = parse_command((char*)line);
+    } else if (head == NULL) {
+        exit(parse_status);
+    }
+    execute_chain(head);
+    fflush(stdout);
+    exit(last_exit_status);
+}
+
+static void start_request(server_conn_t* conn) {
+    const char* line = conn->payload;
+    command_t* head = NULL;
+    int parsed = 0;
+    int parse_status = 0;
+
+    events_remove_fd(conn->fd);
+    if (conn->timer_fd >= 0) events_remove_fd(conn->timer_fd);
+    conn->timer_fd = -1;
+
+    if (parse_is_cacheable(line)) {
+        parse_status = parse_in_server(conn, line, &head);
+        parsed = 1;
+        warm_path_cache(head);
+    }
+
+    metrics_set_command(line);
+    pid_t pid = fork();
+    if (pid == 0) {
+        run_worker(conn, head, parsed, parse_status);
+    }
+    metrics_set_command("");
+    free_command_chain(head);
+
+    int conn_fd = conn->fd;
+    for (int i = 0; i < conn->nfds; i++) close(conn->fds[i]);
+    free(conn->payload);
+    free(conn);
+
+    if (pid < 0) {
+        perror("myshell: fork error");
+        send_reply(conn_fd, 1);
+        close(conn_fd);
+        release_slot();
+        return;
+    }
+    METRIC_INC(forks);
+
+    server_worker_t* worker = (server_worker_t*)malloc(sizeof(server_worker_t));
+    worker->pid = pid;
+    worker->conn_fd = conn_fd;
+    worker->next = worker_list_head;
+    worker_list_head = worker;
+}
+
+static void handle_request_data(int fd, void* data) {
+    server_conn_t* conn = (server_conn_t*)data;
+    (void)fd;
+
+    int result = read_request(conn);
+    if (result < 0) {
+        drop_connection(conn);
+    } else if (result > 0) {
+        start_request(conn);
+    }
+}
+
+static void handle_connection(int fd, void* data) {
+    (void)data;
+
+    int conn_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (conn_fd < 0) {
+        if (errno != EAGAIN && errno != EINTR) perror("myshell: accept error");
+        return;
+    }
+
+    struct ucred peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getsockopt(conn_fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) < 0 || peer.uid != geteuid()) {
+        close(conn_fd);
+        return;
+    }
+
+    server_conn_t* conn = (server_conn_t*)calloc(1, sizeof(server_conn_t));
+    conn->fd = conn_fd;
+    conn->timer_fd = -1;
+    if (events_add_fd(conn_fd, handle_request_data, conn) < 0) {
+        close(conn_fd);
+        free(conn);
+        return;
+    }
+    conn->timer_fd = events_add_timer(SERVER_REQUEST_TIMEOUT_MS, 0, request_timed_out, conn);
+
+    if (++active_workers >= max_workers) {
+        set_listening(0);
+    }
+}
+
+// Called for every reaped child; returns 1 if it was a worker.
+int server_worker_exited(pid_t pid, int status) {
+    server_worker_t** link = &worker_list_head;
+    while (*link != NULL) {
+        server_worker_t* worker = *link;
+        if (worker->pid == pid) {
+            if (WIFSTOPPED(status) || WIFCONTINUED(status)) return 1;
+
+            send_reply(worker->conn_fd, WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status));
+            close(worker->conn_fd);
+            *link = worker->next;
+            free(worker);
+            release_slot();
+            return 1;
+        }
+        link = &worker->next;
+    }
+    return 0;
+}
+
+// Clears the way for bind(): only a socket nobody is listening on (left by
+// a server that died) is removed. Returns -1, having said why, otherwise.
+static int remove_stale_socket(const struct sockaddr_un* addr) {
+    struct stat st;
+    if (lstat(addr->sun_path, &st) < 0) {
+        if (errno == ENOENT) return 0;
+        perror("myshell: stat error");
+        return -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        fprintf(stderr, "myshell: %s: exists and is not a socket\n", addr->sun_path);
+        return -1;
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        perror("myshell: socket error");
+        return -1;
+    }
+    int stale = connect(probe, (const struct sockaddr*)addr, sizeof(*addr)) < 0 && errno == ECONNREFUSED;
+    close(probe);
+    if (!stale) {
+        fprintf(stderr, "myshell: %s: a server is already listening\n", addr->sun_path);
+        return -1;
+    }
+    return unlink(addr->sun_path);
+}
+
+int run_server(const char* path, int workers) {
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "myshell: socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("myshell: socket error");
+        return -1;
+    }
+    if (remove_stale_socket(&addr) < 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    // Only the server's user may connect
+    mode_t old_umask = umask(0077);
+    int bound = bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr));
+    umask(old_umask);
+    if (bound < 0 || listen(listen_fd, SERVER_BACKLOG) < 0) {
+        perror("myshell: bind error");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    socket_path = path;
+
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+    max_workers = workers;
+
+    set_listening(1);
+    events_run();
+
+    // Workers still running finish on their own; their clients just see EOF
+    set_listening(0);
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path);
+    while (worker_list_head != NULL) {
+        server_worker_t* next = worker_list_head->next;
+        close(worker_list_head->conn_fd);
+        free(worker_list_head);
+        worker_list_head = next;
+    }
+    return 0;
+}
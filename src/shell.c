@@ -10,25 +10,20 @@ typedef struct shell_var_t {
 // Static head for the shell variable list (local to this file)
 static shell_var_t* var_list_head = NULL;
 
-// --- Feature 9: Job Control Structures and Globals ---
-typedef struct job_t {
-    pid_t pid;
-    char* cmd_line;
-    int job_id;
-    char* status; // E.g., "Running", "Done", "Stopped"
-    struct job_t* next;
-} job_t;
+// --- Pipeline Options (set -o) ---
+shell_options_t shell_options = {0, PIN_OFF, NULL, 0};
+
+// --- Feature 9: Job Control Globals (job_t lives in shell.h) ---
 
 // Static head for the job list (local to this file)
 static job_t* job_list_head = NULL;
-static int next_job_id = 1;
 
 // Global variable imported from main.c for Feature-7 logic
 extern int last_exit_status; 
 
 // --- Feature-2: Built-in Commands Implementation ---
 
-const char* built_in_cmds[] = {"exit", "cd", "help", "jobs", "history", "set"};
+const char* built_in_cmds[] = {"exit", "cd", "help", "jobs", "fg", "bg", "kill", "hash", "history", "set", "timeout", "limit", "dag"};
 
 void shell_exit(command_t* cmd) { exit(0); }
 
@@ -36,6 +31,7 @@ void shell_cd(command_t* cmd) {
     char* dir = cmd->arglist[1] ? cmd->arglist[1] : getenv("HOME");
     if (chdir(dir) != 0) {
         perror("myshell: cd error");
+        last_exit_status = 1;
     }
 }
 
@@ -45,9 +41,23 @@ void shell_help(command_t* cmd) {
     printf("  cd <directory>      - Changes the current working directory.\n");
     printf("  help                - Displays this help message.\n");
     printf("  jobs                - Lists active background jobs (Feature-9).\n");
+    printf("  fg [%%n]             - Resumes job n in the foreground.\n");
+    printf("  bg [%%n]             - Resumes stopped job n in the background.\n");
+    printf("  kill [-SIG] %%n|pid  - Sends a signal (default TERM) to a job or process.\n");
+    printf("  dag [-j N] [-k] FILE - Runs the 'name(deps): command' tasks in FILE, N at a time.\n");
+    printf("  hash [-r]           - Lists (or clears) remembered command locations.\n");
     printf("  history             - Lists the command history.\n");
+    printf("  history -s PATTERN  - Searches all history for PATTERN (also Ctrl+R).\n");
     printf("  set                 - Lists all shell variables (Feature-8).\n");
+    printf("  set -o [NAME=VALUE] - Lists or sets options: pipesize=BYTES, pinning=off|rr|CPU,...\n");
     printf("  VAR=VALUE           - Sets a shell variable (Feature-8).\n");
+    printf("  timeout DURATION CMD - Runs CMD, sending TERM (then KILL) after DURATION (e.g. 5, 1.5s, 200ms, 2m).\n");
+    printf("  limit [-t CPU_TIME] [-m BYTES] [-n FILES] CMD\n");
+    printf("                      - Runs CMD with CPU time (e.g. 30, 2m), address space or open file limits.\n");
+    printf("  xargs [-0] [-n MAX] CMD [ARGS] [::: ITEMS]\n");
+    printf("                      - Runs CMD with items from stdin (or ITEMS) in as few execs as ARG_MAX allows.\n");
+    printf("  cat [FILE...], tee [-a] [FILE...]\n");
+    printf("                      - Built in (splice/tee/copy_file_range); other options run the external tool.\n");
     printf("\nExternal commands are executed via fork/exec.\n");
 }
 
@@ -98,7 +108,123 @@ char* get_shell_var(const char* name) {
     return NULL; // Not found
 }
 
+// Calls fn for every variable, oldest first (the order they were defined)
+void foreach_shell_var(void (*fn)(const char* name, const char* value, void* data), void* data) {
+    size_t count = 0;
+    for (shell_var_t* current = var_list_head; current != NULL; current = current->next) count++;
+
+    shell_var_t** vars = (shell_var_t**)malloc((count ? count : 1) * sizeof(shell_var_t*));
+    size_t i = count;
+    for (shell_var_t* current = var_list_head; current != NULL; current = current->next) {
+        vars[--i] = current;
+    }
+    for (i = 0; i < count; i++) {
+        fn(vars[i]->name, vars[i]->value, data);
+    }
+    free(vars);
+}
+
+static void print_options(void) {
+    printf("pipesize=%d\n", shell_options.pipe_size);
+    if (shell_options.pin_mode == PIN_OFF) {
+        printf("pinning=off\n");
+    } else if (shell_options.pin_mode == PIN_ROUND_ROBIN) {
+        printf("pinning=rr\n");
+    } else {
+        printf("pinning=");
+        for (int i = 0; i < shell_options.cpu_layout_len; i++) {
+            printf(i ? ",%d" : "%d", shell_options.cpu_layout[i]);
+        }
+        printf("\n");
+    }
+}
+
+// Parses a size such as 1048576, 512k or 4m
+long parse_size(const char* text) {
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || value < 0) return -1;
+    if (*end == 'k' || *end == 'K') { value <<= 10; end++; }
+    else if (*end == 'm' || *end == 'M') { value <<= 20; end++; }
+    else if (*end == 'g' || *end == 'G') { value <<= 30; end++; }
+    return *end == '\0' ? value : -1;
+}
+
+// pinning=off | rr | CPU,CPU,...
+static int set_pinning(const char* value) {
+    if (strcmp(value, "off") == 0) {
+        shell_options.pin_mode = PIN_OFF;
+        return 0;
+    }
+    if (strcmp(value, "rr") == 0) {
+        shell_options.pin_mode = PIN_ROUND_ROBIN;
+        return 0;
+    }
+
+    int count = 1;
+    for (const char* p = value; *p; p++) {
+        if (*p == ',') count++;
+        else if (!isdigit((unsigned char)*p)) return -1;
+    }
+    int* layout = (int*)malloc(count * sizeof(int));
+    const char* p = value;
+    for (int i = 0; i < count; i++) {
+        if (!isdigit((unsigned char)*p)) {
+            free(layout);
+            return -1;
+        }
+        layout[i] = atoi(p);
+        while (*p && *p != ',') p++;
+        if (*p == ',') p++;
+    }
+
+    free(shell_options.cpu_layout);
+    shell_options.cpu_layout = layout;
+    shell_options.cpu_layout_len = count;
+    shell_options.pin_mode = PIN_LAYOUT;
+    return 0;
+}
+
+// `set -o` lists options, `set -o NAME=VALUE` sets one, `set +o NAME` resets it
+static void shell_set_option(command_t* cmd) {
+    char* option = cmd->arglist[2];
+    int reset = (cmd->arglist[1][0] == '+');
+
+    last_exit_status = 0;
+    if (option == NULL) {
+        print_options();
+        return;
+    }
+
+    char* equals = strchr(option, '=');
+    size_t name_len = equals ? (size_t)(equals - option) : strlen(option);
+    const char* value = equals ? equals + 1 : NULL;
+
+    if (strncmp(option, "pipesize", name_len) == 0 && name_len == 8) {
+        long size = reset ? 0 : (value ? parse_size(value) : -1);
+        if (size < 0 || size > INT32_MAX) {
+            fprintf(stderr, "myshell: set: pipesize needs a byte count (e.g. 1m)\n");
+            last_exit_status = 1;
+            return;
+        }
+        shell_options.pipe_size = (int)size;
+    } else if (strncmp(option, "pinning", name_len) == 0 && name_len == 7) {
+        if (set_pinning(reset ? "off" : (value ? value : "")) < 0) {
+            fprintf(stderr, "myshell: set: pinning must be off, rr or a CPU list (e.g. 0,2,4)\n");
+            last_exit_status = 1;
+        }
+    } else {
+        fprintf(stderr, "myshell: set: %s: unknown option\n", option);
+        last_exit_status = 1;
+    }
+}
+
 void shell_set(command_t* cmd) {
+    if (cmd->arglist[1] != NULL && (strcmp(cmd->arglist[1], "-o") == 0 || strcmp(cmd->arglist[1], "+o") == 0)) {
+        shell_set_option(cmd);
+        return;
+    }
+
     // Feature-8: Lists all shell variables
     shell_var_t* current = var_list_head;
     if (current == NULL) {
@@ -112,35 +238,55 @@ void shell_set(command_t* cmd) {
 }
 
 // --- Feature-3: History Implementation ---
-
-void init_history() {
-    for (int i = 0; i < HISTORY_SIZE; i++) {
-        custom_history_list[i] = NULL;
-    }
-    // Set initial environment variables (optional but good practice)
-    set_shell_var("SHELL", "/bin/myshell"); 
-    set_shell_var("VERSION", "v7+");
-}
+//
+// Lines live in the search index (history_index.c); `history`, `history -s`
+// and `!n` all use its history numbers.
 
 void add_to_history_list(const char* cmd_line) {
-    // ... (Existing implementation)
     if (cmd_line == NULL || cmd_line[0] == '\0') return;
+    history_index_add(cmd_line);
+}
 
-    if (history_count == HISTORY_SIZE) {
-        free(custom_history_list[0]);
-        for (int i = 0; i < HISTORY_SIZE - 1; i++) {
-            custom_history_list[i] = custom_history_list[i + 1];
+// `history -s PATTERN`: lists matching lines from the search index, newest first
+static void shell_history_search(command_t* cmd) {
+    if (cmd->arglist[2] == NULL) {
+        fprintf(stderr, "myshell: usage: history -s PATTERN\n");
+        last_exit_status = 1;
+        return;
+    }
+
+    // The parser splits on whitespace, so rejoin multi-word patterns
+    strbuf_t pattern;
+    sb_init(&pattern);
+    for (int i = 2; cmd->arglist[i] != NULL; i++) {
+        if (i > 2) sb_append_char(&pattern, ' ');
+        sb_append(&pattern, cmd->arglist[i]);
+    }
+
+    uint32_t results[256];
+    uint32_t before = history_index_count();
+    size_t found;
+    last_exit_status = 1;
+    while ((found = history_index_search(pattern.data, before, results, 256)) > 0) {
+        for (size_t i = 0; i < found; i++) {
+            printf("%6u  %s\n", history_index_number(results[i]), history_index_entry(results[i]));
         }
-        custom_history_list[HISTORY_SIZE - 1] = strdup(cmd_line);
-    } else {
-        custom_history_list[history_count++] = strdup(cmd_line);
+        before = results[found - 1];
+        last_exit_status = 0;
     }
+    sb_free(&pattern);
 }
 
 void shell_history(command_t* cmd) {
-    // ... (Existing implementation)
-    for (int i = 0; i < history_count; i++) {
-        printf("%4d  %s\n", i + 1, custom_history_list[i]);
+    if (cmd->arglist[1] != NULL && strcmp(cmd->arglist[1], "-s") == 0) {
+        shell_history_search(cmd);
+        return;
+    }
+
+    // The last HISTORY_SIZE lines
+    uint32_t count = history_index_count();
+    for (uint32_t id = count > HISTORY_SIZE ? count - HISTORY_SIZE : 0; id < count; id++) {
+        printf("%4u  %s\n", history_index_number(id), history_index_entry(id));
     }
 }
 
@@ -150,57 +296,566 @@ int reexecute_history(command_t* cmd) {
     
     char* token = cmd->arglist[0];
     int n = atoi(token + 1);
-    
-    if (n < 1 || n > history_count) {
+    const char* entry = n > 0 ? history_index_lookup((uint32_t)n) : NULL;
+
+    if (entry == NULL) {
         fprintf(stderr, "myshell: event not found: %s\n", token);
         return 1;
     }
 
-    char* re_cmd_line = custom_history_list[n - 1];
+    // Parsing may add lines to the index, so run a private copy
+    char* re_cmd_line = strdup(entry);
     printf("%s\n", re_cmd_line);
-    
-    command_t* re_cmd = parse_command(re_cmd_line);
-    if (re_cmd != NULL) {
-        command_t* current_chain = re_cmd;
-        while (current_chain != NULL) {
-            command_t* next = current_chain->next_chain;
-            current_chain->next_chain = NULL;
-            if (current_chain->arglist != NULL && current_chain->arglist[0] != NULL) {
-                if (!handle_builtin(current_chain)) {
-                    execute_command(current_chain);
+
+    execute_chain(parse_command(re_cmd_line));
+    free(re_cmd_line);
+    return 1;
+}
+
+// --- Feature-9: Job Management Functions ---
+
+job_t* create_job(const char* cmd_line) {
+    job_t* job = (job_t*)malloc(sizeof(job_t));
+    job->pgid = 0;
+    job->shared_pgid = 0;
+    job->pids = NULL;
+    job->reaped = NULL;
+    job->nprocs = 0;
+    job->alive = 0;
+    job->last_status = 0;
+    job->cmd_line = strdup(cmd_line);
+    job->job_id = 0;
+    job->status = strdup("Running");
+    job->has_tmodes = 0;
+    job->timer_fd = -1;
+    job->timed_out = 0;
+    job->mem_limited = 0;
+    job->next = NULL;
+    METRIC_INC(jobs_active);
+    return job;
+}
+
+// Records a forked stage. The first stage's pid becomes the process group.
+void job_add_process(job_t* job, pid_t pid) {
+    job->pids = (pid_t*)realloc(job->pids, (job->nprocs + 1) * sizeof(pid_t));
+    job->reaped = (char*)realloc(job->reaped, job->nprocs + 1);
+    job->reaped[job->nprocs] = 0;
+    job->pids[job->nprocs++] = pid;
+    job->alive++;
+    if (job->pgid == 0) {
+        job->pgid = pid;
+    }
+}
+
+static void free_job(job_t* job) {
+    METRIC_SUB(jobs_active, 1);
+    if (job->timer_fd >= 0) {
+        events_remove_fd(job->timer_fd);
+        close(job->timer_fd);
+    }
+    free(job->pids);
+    free(job->reaped);
+    free(job->cmd_line);
+    free(job->status);
+    free(job);
+}
+
+static void set_job_status(job_t* job, const char* status) {
+    free(job->status);
+    job->status = strdup(status);
+}
+
+// Adds a job to the list with the lowest unused id above all current ones
+static void register_job(job_t* job) {
+    int max_id = 0;
+    for (job_t* current = job_list_head; current != NULL; current = current->next) {
+        if (current->job_id > max_id) max_id = current->job_id;
+    }
+    job->job_id = max_id + 1;
+    job->next = job_list_head;
+    job_list_head = job;
+}
+
+static void unregister_job(job_t* job) {
+    job_t** link = &job_list_head;
+    while (*link != NULL) {
+        if (*link == job) {
+            *link = job->next;
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+static int job_has_pid(job_t* job, pid_t pid) {
+    for (int i = 0; i < job->nprocs; i++) {
+        if (job->pids[i] == pid) return 1;
+    }
+    return 0;
+}
+
+// Feature-7: Converts a wait status into the value reported by $?
+static int status_to_exit_code(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    if (WIFSTOPPED(status)) return 128 + WSTOPSIG(status);
+    return 1;
+}
+
+// The job's status once every process has exited, naming any limit it hit
+static const char* job_end_status(job_t* job) {
+    if (job->timed_out) return "Timed out";
+    if (!WIFSIGNALED(job->last_status)) return "Done";
+
+    int sig = WTERMSIG(job->last_status);
+    if (sig == SIGXCPU) return "CPU limit exceeded";
+    if (sig == SIGXFSZ) return "File size limit exceeded";
+    if (job->mem_limited && (sig == SIGSEGV || sig == SIGBUS || sig == SIGABRT)) {
+        return "Memory limit exceeded";
+    }
+    return "Terminated";
+}
+
+// Sends sig to the job. Jobs without job control share the shell's (or a
+// dag task's) process group, so only their own processes are signalled.
+// Returns -1 if a kill() failed.
+static int job_signal(job_t* job, int sig) {
+    if (!job->shared_pgid) return kill(-job->pgid, sig);
+
+    int result = 0;
+    for (int i = 0; i < job->nprocs; i++) {
+        if (!job->reaped[i] && kill(job->pids[i], sig) < 0) result = -1;
+    }
+    return result;
+}
+
+// waitpid() for any process of the job. In a shared group the shell's other
+// children must not be collected, so each pid is asked in turn
+// and a blocking wait blocks on the first one still running.
+static pid_t job_waitpid(job_t* job, int* status, int options) {
+    if (!job->shared_pgid) return waitpid(-job->pgid, status, options);
+
+    int first = -1;
+    for (int i = 0; i < job->nprocs; i++) {
+        if (job->reaped[i]) continue;
+        if (first < 0) first = i;
+        pid_t pid = waitpid(job->pids[i], status, options | WNOHANG);
+        if (pid != 0) return pid;
+    }
+    if (first < 0) {
+        errno = ECHILD;
+        return -1;
+    }
+    if (options & WNOHANG) return 0;
+    return waitpid(job->pids[first], status, options);
+}
+
+// --- Timeouts (`timeout` prefix) ---
+//
+// A job with a timeout owns a timerfd armed at its deadline. While the shell
+// waits on any foreground job, wait_in_foreground() polls every job's timer
+// directly; the rest of the time they sit in the event loop. On expiry the job gets
+// SIGTERM, and SIGKILL if it is still there TIMEOUT_KILL_GRACE_MS later.
+
+#define TIMEOUT_KILL_GRACE_MS 2000
+
+static void arm_job_timer(job_t* job, long ms) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+        spec.it_value.tv_nsec = 1; // A zero it_value would disarm the timer
+    }
+    timerfd_settime(job->timer_fd, 0, &spec, NULL);
+}
+
+void job_set_timeout(job_t* job, long timeout_ms) {
+    job->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (job->timer_fd < 0) {
+        perror("myshell: timerfd_create error");
+        return;
+    }
+    arm_job_timer(job, timeout_ms);
+}
+
+static void job_timer_fired(job_t* job) {
+    uint64_t expirations;
+    if (read(job->timer_fd, &expirations, sizeof(expirations)) < 0) {
+        return; // Nothing pending
+    }
+
+    if (job->timed_out == 0) {
+        job->timed_out = 1;
+        job_signal(job, SIGTERM);
+        job_signal(job, SIGCONT); // A stopped job must run to act on SIGTERM
+        if (job->job_id != 0) {
+            set_job_status(job, "Timing out");
+        }
+        arm_job_timer(job, TIMEOUT_KILL_GRACE_MS);
+    } else if (job->timed_out == 1) {
+        job->timed_out = 2;
+        job_signal(job, SIGKILL);
+    }
+}
+
+static void job_timer_event(int fd, void* data) {
+    (void)fd;
+    job_timer_fired((job_t*)data);
+}
+
+void put_job_in_background(job_t* job) {
+    if (job->nprocs == 0) {
+        free_job(job);
+        return;
+    }
+    register_job(job);
+    if (job->timer_fd >= 0) {
+        events_add_fd(job->timer_fd, job_timer_event, job);
+    }
+    printf("[%d] %d\n", job->job_id, job->pgid);
+}
+
+// Records that one of the job's processes has exited
+static void job_process_exited(job_t* job, pid_t pid, int status) {
+    for (int i = 0; i < job->nprocs; i++) {
+        if (job->pids[i] == pid) job->reaped[i] = 1;
+    }
+    job->alive--;
+    if (pid == job->pids[job->nprocs - 1]) {
+        job->last_status = status;
+    }
+}
+
+// Records one wait status of a job's process; returns 1 if it stopped
+static int job_wait_status(job_t* job, pid_t pid, int status) {
+    if (WIFSTOPPED(status)) {
+        job->last_status = status;
+        return 1;
+    }
+    job_process_exited(job, pid, status);
+    return 0;
+}
+
+// Foreground wait for a job. Sleeps in poll() on a pidfd per live process,
+// the signal fd (which reports stops) and the timers of this job and of
+// every background job, so any deadline is acted on as soon as it passes.
+// Returns 1 if the job stopped.
+static int wait_in_foreground(job_t* job) {
+    int ntimed = 0;
+    for (job_t* other = job_list_head; other != NULL; other = other->next) {
+        if (other != job && other->timer_fd >= 0) ntimed++;
+    }
+    int first_timer = job->nprocs + 2;
+    int nfds = first_timer + ntimed;
+    struct pollfd* fds = (struct pollfd*)calloc(nfds, sizeof(struct pollfd));
+    job_t** timed_jobs = (job_t**)calloc(ntimed ? ntimed : 1, sizeof(job_t*));
+    int have_pidfds = 1;
+    int reap_others = 0;
+    int stopped = 0;
+    sigset_t forward; // Signals for the event loop's handler once we return
+    sigemptyset(&forward);
+
+    fds[0].fd = job->timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = shell_signal_fd;
+    fds[1].events = POLLIN;
+    for (int i = 0; i < job->nprocs; i++) {
+        // A reaped pid may already belong to another process
+        fds[i + 2].fd = job->reaped[i] ? -1 : (int)syscall(SYS_pidfd_open, job->pids[i], 0);
+        fds[i + 2].events = POLLIN;
+        if (fds[i + 2].fd < 0 && !job->reaped[i] && errno == ENOSYS) have_pidfds = 0;
+    }
+    // Background jobs stay in the list (and their timers open) until the
+    // SIGCHLDs consumed here are handled after the wait
+    int t = 0;
+    for (job_t* other = job_list_head; other != NULL; other = other->next) {
+        if (other != job && other->timer_fd >= 0) {
+            timed_jobs[t] = other;
+            fds[first_timer + t].fd = other->timer_fd;
+            fds[first_timer + t].events = POLLIN;
+            t++;
+        }
+    }
+
+    while (job->alive > 0 && !stopped) {
+        pid_t pid = 0;
+        int status;
+        while (job->alive > 0 && !stopped && (pid = job_waitpid(job, &status, WNOHANG | WUNTRACED)) > 0) {
+            stopped = job_wait_status(job, pid, status);
+            for (int i = 0; i < job->nprocs; i++) {
+                if (job->pids[i] == pid && fds[i + 2].fd >= 0) {
+                    close(fds[i + 2].fd);
+                    fds[i + 2].fd = -1; // poll() skips negative fds
+                }
+            }
+        }
+        if (stopped || job->alive == 0 || (pid < 0 && errno == ECHILD)) break;
+
+        // Without pidfds (kernels before 5.3) fall back to short sleeps
+        if (poll(fds, nfds, have_pidfds ? -1 : 10) < 0) {
+            if (errno == EINTR) continue;
+            perror("myshell: poll error");
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            job_timer_fired(job);
+        }
+        for (int i = 0; i < ntimed; i++) {
+            if (fds[first_timer + i].revents & POLLIN) job_timer_fired(timed_jobs[i]);
+        }
+        if (fds[1].revents & POLLIN) {
+            // Consumed here, so other jobs' SIGCHLDs are handled afterwards
+            // and the rest (SIGINT, SIGWINCH, ...) are raised again for the
+            // event loop
+            struct signalfd_siginfo info;
+            while (read(shell_signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                if (info.ssi_signo == SIGCHLD) {
+                    reap_others = 1;
+                } else {
+                    if (info.ssi_signo == SIGHUP) {
+                        // A new foreground job is not in the job list: hang it up here
+                        job_signal(job, SIGHUP);
+                        job_signal(job, SIGCONT);
+                    }
+                    sigaddset(&forward, (int)info.ssi_signo);
                 }
             }
-            free_command(current_chain);
-            current_chain = next;
         }
     }
-    return 1;
+
+    for (int i = 2; i < first_timer; i++) {
+        if (fds[i].fd >= 0) close(fds[i].fd);
+    }
+    free(fds);
+    free(timed_jobs);
+    if (reap_others) {
+        reap_children();
+    }
+    // Still blocked, so they stay pending until the signal fd is read
+    for (int sig = 1; sig < NSIG; sig++) {
+        if (sigismember(&forward, sig) == 1) raise(sig);
+    }
+    return stopped;
 }
 
-// --- Feature-9: Job Management Functions ---
+// Runs a job in the foreground until every stage has exited or the job is
+// stopped (Ctrl+Z), then takes the terminal back. Takes ownership of job:
+// stopped jobs stay in (or enter) the job list, finished ones are freed.
+void wait_for_job(job_t* job) {
+    int stopped = 0;
 
-void add_job(pid_t pid, const char* cmd_line, int is_background) {
-    if (!is_background) return; // Only track background jobs
+    if (job->nprocs == 0) {
+        last_exit_status = 1;
+        free_job(job);
+        return;
+    }
 
-    job_t* new_job = (job_t*)malloc(sizeof(job_t));
-    new_job->pid = pid;
-    new_job->cmd_line = strdup(cmd_line);
-    new_job->job_id = next_job_id++;
-    new_job->status = strdup("Running"); 
-    new_job->next = job_list_head;
-    job_list_head = new_job;
+    give_terminal_to(job->pgid, job->has_tmodes ? &job->tmodes : NULL);
+
+    if (job->timer_fd >= 0) {
+        events_remove_fd(job->timer_fd); // Polled directly while we wait
+    }
+    stopped = wait_in_foreground(job);
+
+    if (shell_is_interactive && stopped) {
+        job->has_tmodes = (tcgetattr(STDIN_FILENO, &job->tmodes) == 0);
+    }
+    give_terminal_to(shell_pgid, NULL);
+    metrics_update_child_cpu();
+
+    // GNU timeout's convention: 124 when the deadline passed
+    last_exit_status = (job->timed_out && !stopped) ? 124 : status_to_exit_code(job->last_status);
+
+    if (stopped) {
+        set_job_status(job, "Stopped");
+        if (job->job_id == 0) {
+            register_job(job);
+        }
+        if (job->timer_fd >= 0) {
+            events_add_fd(job->timer_fd, job_timer_event, job); // The deadline still runs
+        }
+        printf("\n[%d] %s\t\t%s\n", job->job_id, job->status, job->cmd_line);
+        return;
+    }
+
+    // Finish the "^C" the terminal echoed for an interrupted job
+    if (shell_is_interactive && WIFSIGNALED(job->last_status) && WTERMSIG(job->last_status) == SIGINT) {
+        printf("\n");
+    }
+
+    const char* end_status = job_end_status(job);
+    if (strcmp(end_status, "Done") != 0 && strcmp(end_status, "Terminated") != 0) {
+        fprintf(stderr, "myshell: %s: %s\n", job->cmd_line, end_status);
+    }
+
+    if (job->job_id != 0) {
+        unregister_job(job);
+    }
+    METRIC_INC(jobs_finished);
+    free_job(job);
+}
+
+// Called from the event loop for every child collected by reap_children().
+// Finished background jobs are reported right away and dropped from the list.
+void job_reaped(pid_t pid, int status) {
+    job_t* job = job_list_head;
+    while (job != NULL && !job_has_pid(job, pid)) {
+        job = job->next;
+    }
+    if (job == NULL) return;
+
+    if (WIFSTOPPED(status)) {
+        if (strcmp(job->status, "Stopped") == 0) return; // Another stage of a job already reported
+        set_job_status(job, "Stopped");
+        shell_notify("\n[%d] %s\t\t%s\n", job->job_id, job->status, job->cmd_line);
+        return;
+    }
+    if (WIFCONTINUED(status)) {
+        set_job_status(job, "Running");
+        return;
+    }
+
+    job_process_exited(job, pid, status);
+    if (job->alive > 0) return;
+
+    set_job_status(job, job_end_status(job));
+    shell_notify("\n[%d] %s\t\t%s\n", job->job_id, job->status, job->cmd_line);
+    unregister_job(job);
+    METRIC_INC(jobs_finished);
+    free_job(job);
+}
+
+// Resolves "%n", "n" or no argument (the most recent job)
+static job_t* find_job(const char* spec) {
+    if (spec == NULL) {
+        job_t* latest = job_list_head;
+        for (job_t* current = job_list_head; current != NULL; current = current->next) {
+            if (current->job_id > latest->job_id) latest = current;
+        }
+        return latest;
+    }
+
+    int id = atoi(spec[0] == '%' ? spec + 1 : spec);
+    for (job_t* current = job_list_head; current != NULL; current = current->next) {
+        if (current->job_id == id) return current;
+    }
+    return NULL;
+}
+
+void shell_fg(command_t* cmd) {
+    job_t* job = find_job(cmd->arglist[1]);
+    if (job == NULL) {
+        fprintf(stderr, "myshell: fg: no such job\n");
+        last_exit_status = 1;
+        return;
+    }
+
+    printf("%s\n", job->cmd_line);
+    set_job_status(job, "Running");
+    give_terminal_to(job->pgid, job->has_tmodes ? &job->tmodes : NULL);
+    if (job_signal(job, SIGCONT) < 0) {
+        perror("myshell: fg error");
+    }
+    wait_for_job(job);
+}
+
+void shell_bg(command_t* cmd) {
+    job_t* job = find_job(cmd->arglist[1]);
+    if (job == NULL) {
+        fprintf(stderr, "myshell: bg: no such job\n");
+        last_exit_status = 1;
+        return;
+    }
+
+    if (job_signal(job, SIGCONT) < 0) {
+        perror("myshell: bg error");
+        last_exit_status = 1;
+        return;
+    }
+    set_job_status(job, "Running");
+    printf("[%d] %s &\n", job->job_id, job->cmd_line);
+    last_exit_status = 0;
+}
+
+// Accepts -9, -KILL and -SIGKILL style signal arguments
+static int parse_signal(const char* arg) {
+    static const struct { const char* name; int sig; } signals[] = {
+        {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"KILL", SIGKILL},
+        {"TERM", SIGTERM}, {"STOP", SIGSTOP}, {"TSTP", SIGTSTP}, {"CONT", SIGCONT},
+        {"USR1", SIGUSR1}, {"USR2", SIGUSR2}
+    };
+
+    if (isdigit((unsigned char)arg[0])) return atoi(arg);
+    if (strncmp(arg, "SIG", 3) == 0) arg += 3;
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        if (strcmp(arg, signals[i].name) == 0) return signals[i].sig;
+    }
+    return -1;
+}
+
+void shell_kill(command_t* cmd) {
+    int sig = SIGTERM;
+    int argi = 1;
+
+    if (cmd->arglist[1] != NULL && cmd->arglist[1][0] == '-') {
+        sig = parse_signal(cmd->arglist[1] + 1);
+        argi++;
+    }
+    if (sig < 0 || cmd->arglist[argi] == NULL) {
+        fprintf(stderr, "myshell: usage: kill [-SIG] %%n|pid ...\n");
+        last_exit_status = 1;
+        return;
+    }
+
+    last_exit_status = 0;
+    for (; cmd->arglist[argi] != NULL; argi++) {
+        char* target = cmd->arglist[argi];
+
+        if (target[0] != '%') {
+            if (kill(atoi(target), sig) < 0) {
+                perror("myshell: kill error");
+                last_exit_status = 1;
+            }
+            continue;
+        }
+
+        job_t* job = find_job(target);
+        if (job == NULL) {
+            fprintf(stderr, "myshell: kill: %s: no such job\n", target);
+            last_exit_status = 1;
+            continue;
+        }
+        // Signal every stage of the pipeline
+        if (job_signal(job, sig) < 0) {
+            perror("myshell: kill error");
+            last_exit_status = 1;
+        } else if (sig != SIGKILL && sig != SIGCONT && sig != SIGSTOP && sig != SIGTSTP &&
+                   strcmp(job->status, "Stopped") == 0) {
+            // A stopped job only acts on the signal once it runs again
+            job_signal(job, SIGCONT);
+        }
+    }
+}
+
+// Passes a hangup on to every job, as sh does when its terminal goes away.
+// Stopped jobs are continued so that they see the SIGHUP.
+void hangup_jobs(void) {
+    for (job_t* job = job_list_head; job != NULL; job = job->next) {
+        if (job->alive == 0) continue;
+        job_signal(job, SIGHUP);
+        job_signal(job, SIGCONT);
+    }
 }
 
 void cleanup_job_list(void) {
-    // Note: The SIGCHLD handler in main.c handles status updates. 
+    // Note: Status updates arrive through job_reaped() from the event loop.
     // This simple cleanup function is primarily for the shell exit.
     job_t *current = job_list_head;
     job_t *next = NULL;
     while(current != NULL) {
         next = current->next;
-        free(current->cmd_line);
-        free(current->status);
-        free(current);
+        free_job(current);
         current = next;
     }
     job_list_head = NULL;
@@ -208,7 +863,7 @@ void cleanup_job_list(void) {
 
 // --- Built-in Command Dispatch (Feature 8 Fix) ---
 
-int handle_builtin(command_t* cmd) {
+static int dispatch_builtin(command_t* cmd) {
     if (cmd == NULL || cmd->arglist == NULL || cmd->arglist[0] == NULL || cmd->next_pipe != NULL) {
         return 0;
     }
@@ -223,6 +878,8 @@ int handle_builtin(command_t* cmd) {
         // Basic validation: ensure name is not empty
         if (cmd_name[0] == '\0') {
             fprintf(stderr, "myshell: Syntax error: variable name missing.\n");
+            *equals = '=';
+            last_exit_status = 1;
             return 1;
         }
 
@@ -247,6 +904,21 @@ int handle_builtin(command_t* cmd) {
     } else if (strcmp(cmd_name, "jobs") == 0) {
         shell_jobs(cmd);
         return 1;
+    } else if (strcmp(cmd_name, "fg") == 0) {
+        shell_fg(cmd);
+        return 1;
+    } else if (strcmp(cmd_name, "bg") == 0) {
+        shell_bg(cmd);
+        return 1;
+    } else if (strcmp(cmd_name, "kill") == 0) {
+        shell_kill(cmd);
+        return 1;
+    } else if (strcmp(cmd_name, "dag") == 0) {
+        shell_dag(cmd);
+        return 1;
+    } else if (strcmp(cmd_name, "hash") == 0) {
+        shell_hash(cmd);
+        return 1;
     } else if (strcmp(cmd_name, "history") == 0) {
         shell_history(cmd);
         return 1;
@@ -258,6 +930,21 @@ int handle_builtin(command_t* cmd) {
     return 0; // Not a built-in
 }
 
+// Builtins succeed ($? = 0) unless they report a failure themselves
+int handle_builtin(command_t* cmd) {
+    int saved_status = last_exit_status;
+    last_exit_status = 0;
+
+    int handled = dispatch_builtin(cmd);
+    if (handled) {
+        METRIC_INC(builtin_hits);
+        METRIC_INC(commands_executed);
+    } else {
+        last_exit_status = saved_status;
+    }
+    return handled;
+}
+
 // --- Feature-4: Tab Completion Implementation ---
 
 char** my_completion(const char* text, int start, int end) {
@@ -274,6 +961,7 @@ command_t* create_command() {
     cmd->next_pipe = NULL;
     cmd->is_background = 0;
     cmd->next_chain = NULL;
+    cmd->chain_op = CHAIN_ALWAYS;
     return cmd;
 }
 
@@ -297,7 +985,8 @@ void free_command(command_t* cmd) {
 char* substitute_variables(const char* token) {
     if (token == NULL || token[0] == '\0') return strdup(token);
     
-    char buffer[2048] = {0};
+    strbuf_t buffer;
+    sb_init(&buffer);
     const char* p = token;
     
     while (*p != '\0') {
@@ -314,35 +1003,31 @@ char* substitute_variables(const char* token) {
             if (p == var_start && *p == '?') {
                 char status_str[16];
                 snprintf(status_str, sizeof(status_str), "%d", last_exit_status);
-                strcat(buffer, status_str);
+                sb_append(&buffer, status_str);
                 p++;
                 continue;
             }
 
             size_t name_len = p - var_start;
             if (name_len > 0) {
-                char name[256];
-                strncpy(name, var_start, name_len);
-                name[name_len] = '\0';
-                
+                char* name = strndup(var_start, name_len);
                 char* value = get_shell_var(name);
                 if (value != NULL) {
-                    strcat(buffer, value);
+                    sb_append(&buffer, value);
                 }
+                free(name);
             } else {
                 // Lone '$' or malformed, treat as literal
-                strcat(buffer, "$");
+                sb_append_char(&buffer, '$');
             }
         } else {
             // Append regular character
-            size_t len = strlen(buffer);
-            buffer[len] = *p;
-            buffer[len + 1] = '\0';
+            sb_append_char(&buffer, *p);
             p++;
         }
     }
     
-    return strdup(buffer);
+    return sb_detach(&buffer);
 }
 
 command_t* parse_chain_segment(char* segment) {
@@ -369,7 +1054,7 @@ command_t* parse_chain_segment(char* segment) {
     pipe_segment = strtok_r(segment_copy, "|", &saveptr_pipe);
     
     while (pipe_segment != NULL) {
-        if (current_cmd != head) {
+        if (current_cmd->arglist != NULL) { // Every stage after the first gets its own node
             current_cmd->next_pipe = create_command();
             current_cmd = current_cmd->next_pipe;
         }
@@ -397,8 +1082,10 @@ command_t* parse_chain_segment(char* segment) {
         }
         free(count_copy);
 
-        current_cmd->arglist = (char**)calloc(arg_count + 1, sizeof(char*));
-        int i = 0;
+        // Glob expansion can grow the list past the pass-1 estimate
+        size_t arg_cap = arg_count + 1;
+        current_cmd->arglist = (char**)calloc(arg_cap, sizeof(char*));
+        size_t i = 0;
         
         // Pass 2: Populate arglist and redirection fields
         token = strtok_r(token_segment, " \t\r\n\a", &saveptr_token);
@@ -411,7 +1098,27 @@ command_t* parse_chain_segment(char* segment) {
                 if (token) current_cmd->output_file = strdup(token);
             } else {
                 // Feature-8: Perform substitution before storing the argument
-                current_cmd->arglist[i++] = substitute_variables(token);
+                char* arg = substitute_variables(token);
+                size_t match_count = 0;
+                char** matches = has_glob_chars(arg) ? expand_glob(arg, &match_count) : NULL;
+
+                if (matches != NULL) {
+                    // Pathname expansion replaces the word with every match
+                    if (i + match_count + 1 > arg_cap) {
+                        arg_cap = i + match_count + arg_count + 1;
+                        current_cmd->arglist = (char**)realloc(current_cmd->arglist, arg_cap * sizeof(char*));
+                    }
+                    memcpy(current_cmd->arglist + i, matches, match_count * sizeof(char*));
+                    i += match_count;
+                    free(matches);
+                    free(arg);
+                } else {
+                    if (i + 2 > arg_cap) {
+                        arg_cap *= 2;
+                        current_cmd->arglist = (char**)realloc(current_cmd->arglist, arg_cap * sizeof(char*));
+                    }
+                    current_cmd->arglist[i++] = arg;
+                }
             }
             token = strtok_r(NULL, " \t\r\n\a", &saveptr_token);
         }
@@ -443,7 +1150,8 @@ command_t* parse_if_block(char* block) {
     
     enum { IF_WAIT, THEN_WAIT, ELSE_WAIT, IF_CMD, THEN_CMD, ELSE_CMD, END_BLOCK } state = IF_WAIT;
     
-    char cmd_buffer[2048] = {0};
+    strbuf_t cmd_buffer;
+    sb_init(&cmd_buffer);
     
     int execute_then = 0; 
     
@@ -456,30 +1164,24 @@ command_t* parse_if_block(char* block) {
             state = THEN_WAIT;
             
             // 1. EVALUATE THE IF CONDITION (stored in cmd_buffer)
-            if (cmd_buffer[0] != '\0') {
-                command_t* condition_cmd = parse_command(cmd_buffer);
-                
-                if (condition_cmd != NULL) {
-                    if (!handle_builtin(condition_cmd)) {
-                        execute_command(condition_cmd);
-                    }
-                    free_command(condition_cmd);
-                }
+            if (cmd_buffer.len > 0) {
+                command_t* condition_cmd = parse_command(cmd_buffer.data);
+                execute_chain(condition_cmd); // Frees it
                 
                 execute_then = (last_exit_status == 0); 
             }
-            cmd_buffer[0] = '\0';
+            sb_clear(&cmd_buffer);
             state = THEN_CMD;
 
         } else if (strcmp(token, "else") == 0) {
             state = ELSE_CMD;
-            cmd_buffer[0] = '\0';
+            sb_clear(&cmd_buffer);
 
         } else if (strcmp(token, "fi") == 0) {
             // END OF BLOCK
             
             // 2. PROCESS THE FINAL BLOCK (either THEN or ELSE)
-            if (cmd_buffer[0] != '\0') {
+            if (cmd_buffer.len > 0) {
                 int execute_final_block = 0;
                 
                 if (state == THEN_CMD) {
@@ -489,7 +1191,7 @@ command_t* parse_if_block(char* block) {
                 }
                 
                 if (execute_final_block) {
-                    command_t* final_cmd_chain = parse_command(cmd_buffer);
+                    command_t* final_cmd_chain = parse_command(cmd_buffer.data);
                     
                     if (final_cmd_chain) {
                         if (head_chain == NULL) {
@@ -506,22 +1208,23 @@ command_t* parse_if_block(char* block) {
                     }
                 }
             }
-            cmd_buffer[0] = '\0';
+            sb_clear(&cmd_buffer);
             state = END_BLOCK;
             break; 
             
         } else if (state == IF_CMD || state == THEN_CMD || state == ELSE_CMD) {
             // 3. Collect commands for the current block
-            if (cmd_buffer[0] != '\0') {
-                strcat(cmd_buffer, " ");
+            if (cmd_buffer.len > 0) {
+                sb_append_char(&cmd_buffer, ' ');
             }
-            strcat(cmd_buffer, token);
+            sb_append(&cmd_buffer, token);
         }
         
         token = strtok_r(NULL, " \t\r\n", &saveptr_block);
     }
     
     free(block_copy);
+    sb_free(&cmd_buffer);
     return head_chain;
 }
 
@@ -535,15 +1238,31 @@ command_t* parse_command(char* line) {
     }
     
     command_t* head_chain = NULL;
-    command_t* current_chain_link = NULL;
+    command_t* tail_chain = NULL;
     
     char* line_copy = strdup(line);
-    char* segment;
-    char* saveptr_chain;
-    
-    segment = strtok_r(line_copy, ";", &saveptr_chain);
+    char* segment = line_copy;
+    int op = CHAIN_ALWAYS; // Operator in front of the current segment
     
     while (segment != NULL) {
+        // The segment ends at ';', '&&', '||' or the end of the line.
+        // A single '&' (background) or '|' (pipe) stays inside it.
+        char* end = segment;
+        char* rest = NULL;
+        int next_op = CHAIN_ALWAYS;
+        for (; *end != '\0'; end++) {
+            if (*end == ';') {
+                rest = end + 1;
+                break;
+            }
+            if ((end[0] == '&' && end[1] == '&') || (end[0] == '|' && end[1] == '|')) {
+                next_op = (end[0] == '&') ? CHAIN_AND : CHAIN_OR;
+                rest = end + 2;
+                break;
+            }
+        }
+        *end = '\0';
+        
         size_t len = strlen(segment);
         while (len > 0 && isspace((unsigned char)segment[len-1])) {
             segment[--len] = '\0';
@@ -553,30 +1272,108 @@ command_t* parse_command(char* line) {
             trimmed_segment++;
         }
         
+        // '&&' and '||' need a command on both sides
+        if (*trimmed_segment == '\0' && (op != CHAIN_ALWAYS || next_op != CHAIN_ALWAYS)) {
+            fprintf(stderr, "myshell: syntax error near '%s'\n",
+                    (op == CHAIN_AND || (op == CHAIN_ALWAYS && next_op == CHAIN_AND)) ? "&&" : "||");
+            free_command_chain(head_chain);
+            free(line_copy);
+            last_exit_status = 2;
+            return NULL;
+        }
+        
         if (*trimmed_segment) {
             command_t* new_cmd_head = parse_chain_segment(trimmed_segment);
             
             if (new_cmd_head != NULL) {
+                new_cmd_head->chain_op = op;
                 if (head_chain == NULL) {
                     head_chain = new_cmd_head;
-                    current_chain_link = new_cmd_head;
                 } else {
-                    command_t* runner = head_chain;
-                    while (runner->next_chain != NULL) {
-                        runner = runner->next_chain;
-                    }
-                    runner->next_chain = new_cmd_head;
-                    current_chain_link = new_cmd_head;
-                }
-                
-                while (current_chain_link->next_pipe != NULL) {
-                    current_chain_link = current_chain_link->next_pipe;
+                    tail_chain->next_chain = new_cmd_head;
                 }
+                tail_chain = new_cmd_head;
             }
         }
-        segment = strtok_r(NULL, ";", &saveptr_chain);
+        
+        op = next_op;
+        segment = rest;
     }
     
     free(line_copy);
     return head_chain;
 }
+
+// --- Parsed-command cache ---
+//
+// Lines without '$' or wildcards always parse to the same structure, so their
+// parse is kept (direct-mapped by hash) and later runs get a deep copy.
+// Anything with variables, globs or an if block is parsed fresh every time.
+
+#define PARSE_CACHE_SIZE 256
+
+typedef struct parse_cache_entry_t {
+    char* line;
+    command_t* parsed;
+} parse_cache_entry_t;
+
+static parse_cache_entry_t parse_cache[PARSE_CACHE_SIZE];
+
+command_t* clone_command(const command_t* cmd) {
+    if (cmd == NULL) return NULL;
+
+    command_t* copy = create_command();
+    if (cmd->arglist != NULL) {
+        int argc = 0;
+        while (cmd->arglist[argc] != NULL) argc++;
+        copy->arglist = (char**)calloc(argc + 1, sizeof(char*));
+        for (int i = 0; i < argc; i++) {
+            copy->arglist[i] = strdup(cmd->arglist[i]);
+        }
+    }
+    copy->input_file = cmd->input_file ? strdup(cmd->input_file) : NULL;
+    copy->output_file = cmd->output_file ? strdup(cmd->output_file) : NULL;
+    copy->is_background = cmd->is_background;
+    copy->chain_op = cmd->chain_op;
+    copy->next_pipe = clone_command(cmd->next_pipe);
+    copy->next_chain = clone_command(cmd->next_chain);
+    return copy;
+}
+
+void free_command_chain(command_t* head) {
+    while (head != NULL) {
+        command_t* next = head->next_chain;
+        free_command(head);
+        head = next;
+    }
+}
+
+// A cacheable line's parse runs nothing and does not depend on the cwd
+int parse_is_cacheable(const char* line) {
+    if (strchr(line, '$') != NULL || has_glob_chars(line)) return 0;
+    return !(strstr(line, "\n") != NULL && strstr(line, "if") != NULL && strstr(line, "fi") != NULL);
+}
+
+command_t* parse_command_cached(char* line) {
+    if (line == NULL || line[0] == '\0') return NULL;
+    if (!parse_is_cacheable(line)) return parse_command(line);
+
+    // FNV-1a hash picks the slot
+    uint32_t hash = 2166136261u;
+    for (const char* p = line; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    parse_cache_entry_t* entry = &parse_cache[hash % PARSE_CACHE_SIZE];
+
+    if (entry->line == NULL || strcmp(entry->line, line) != 0) {
+        // A syntax error is not cached, so every run reports it and sets $?
+        command_t* parsed = parse_command(line);
+        if (parsed == NULL) return NULL;
+
+        free(entry->line);
+        free_command_chain(entry->parsed);
+        entry->line = strdup(line);
+        entry->parsed = parsed;
+    }
+    return clone_command(entry->parsed);
+}
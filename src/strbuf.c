@@ -0,0 +1,49 @@
+#include "shell.h"
+
+// --- Growable string buffer (replaces fixed-size char arrays) ---
+
+void sb_init(strbuf_t* sb) {
+    sb->cap = 64;
+    sb->len = 0;
+    sb->data = (char*)malloc(sb->cap);
+    sb->data[0] = '\0';
+}
+
+void sb_append_n(strbuf_t* sb, const char* s, size_t n) {
+    if (sb->len + n + 1 > sb->cap) {
+        while (sb->len + n + 1 > sb->cap) {
+            sb->cap *= 2;
+        }
+        sb->data = (char*)realloc(sb->data, sb->cap);
+    }
+    memcpy(sb->data + sb->len, s, n);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+}
+
+void sb_append(strbuf_t* sb, const char* s) {
+    sb_append_n(sb, s, strlen(s));
+}
+
+void sb_append_char(strbuf_t* sb, char c) {
+    sb_append_n(sb, &c, 1);
+}
+
+void sb_clear(strbuf_t* sb) {
+    sb->len = 0;
+    sb->data[0] = '\0';
+}
+
+// Hands the string to the caller, who must free() it
+char* sb_detach(strbuf_t* sb) {
+    char* data = sb->data;
+    sb->data = NULL;
+    sb->len = sb->cap = 0;
+    return data;
+}
+
+void sb_free(strbuf_t* sb) {
+    free(sb->data);
+    sb->data = NULL;
+    sb->len = sb->cap = 0;
+}
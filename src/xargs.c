@@ -0,0 +1,231 @@
+#include "shell.h"
+
+extern char** environ;
+
+// --- xargs builtin: pack streamed arguments into as few execs as possible ---
+//
+//   xargs [-0] [-n MAX] [COMMAND [ARGS...]] [::: ITEMS...]
+//
+// Items are read from stdin (whitespace separated, or NUL separated with
+// -0), or taken from the words after ':::' -- typically a glob expansion,
+// which the shell itself can hold without any ARG_MAX limit. Each exec gets
+// as many items as fit in sysconf(_SC_ARG_MAX) after the environment.
+// Runs inside a forked pipeline stage (see run_stage_builtin()).
+
+#define XARGS_READ_CHUNK (64 * 1024)
+#define XARGS_MAX_ARG_STRLEN (32 * 4096) // Linux limit on a single argument
+
+typedef struct xargs_batch_t {
+    char** argv;
+    size_t argc;
+    size_t cap;
+    size_t fixed;      // Command and its initial arguments
+    size_t bytes;      // Argument space used, counted the way execve() does
+    size_t fixed_bytes;
+    size_t limit;
+    size_t max_items;  // -n, 0 = no limit
+    int status;        // Exit status xargs will report
+    int stop;          // Set when a command failure ends the run early
+} xargs_batch_t;
+
+static size_t arg_cost(const char* arg) {
+    return strlen(arg) + 1 + sizeof(char*);
+}
+
+static size_t exec_arg_limit(void) {
+    long arg_max = sysconf(_SC_ARG_MAX);
+    if (arg_max <= 0) arg_max = 128 * 1024;
+
+    size_t env = sizeof(char*);
+    for (char** e = environ; *e != NULL; e++) {
+        env += arg_cost(*e);
+    }
+
+    // Same headroom POSIX requires xargs to leave for the command's own use
+    size_t headroom = 2048 + sizeof(char*);
+    return (size_t)arg_max > env + headroom ? (size_t)arg_max - env - headroom : 0;
+}
+
+static void batch_run(xargs_batch_t* batch) {
+    if (batch->argc == batch->fixed) return;
+
+    batch->argv[batch->argc] = NULL;
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(batch->argv[0], batch->argv);
+        int exec_errno = errno;
+        perror("myshell: xargs: execution error");
+        exit(exec_errno == ENOENT ? 127 : 126);
+    } else if (pid < 0) {
+        perror("myshell: xargs: fork error");
+        batch->status = 1;
+        batch->stop = 1;
+    } else {
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+        // GNU xargs conventions: 123 any failure, 124 a command exited 255,
+        // 125 a command was killed, 126/127 a command could not be run
+        if (WIFSIGNALED(status)) {
+            batch->status = 125;
+            batch->stop = 1;
+        } else if (WEXITSTATUS(status) == 255) {
+            batch->status = 124;
+            batch->stop = 1;
+        } else if (WEXITSTATUS(status) == 126 || WEXITSTATUS(status) == 127) {
+            batch->status = WEXITSTATUS(status);
+            batch->stop = 1;
+        } else if (WEXITSTATUS(status) != 0) {
+            batch->status = 123;
+        }
+    }
+
+    for (size_t i = batch->fixed; i < batch->argc; i++) {
+        free(batch->argv[i]);
+    }
+    batch->argc = batch->fixed;
+    batch->bytes = batch->fixed_bytes;
+}
+
+// Takes ownership of item
+static void batch_add(xargs_batch_t* batch, char* item) {
+    size_t cost = arg_cost(item);
+
+    if (strlen(item) >= XARGS_MAX_ARG_STRLEN || batch->fixed_bytes + cost > batch->limit) {
+        fprintf(stderr, "myshell: xargs: argument too long\n");
+        batch->status = 1;
+        free(item);
+        return;
+    }
+    if (batch->bytes + cost > batch->limit) {
+        batch_run(batch);
+        if (batch->stop) {
+            free(item);
+            return;
+        }
+    }
+
+    if (batch->argc + 2 > batch->cap) {
+        batch->cap *= 2;
+        batch->argv = (char**)realloc(batch->argv, batch->cap * sizeof(char*));
+    }
+    batch->argv[batch->argc++] = item;
+    batch->bytes += cost;
+
+    if (batch->max_items > 0 && batch->argc - batch->fixed >= batch->max_items) {
+        batch_run(batch);
+    }
+}
+
+static void read_items(xargs_batch_t* batch, int null_separated) {
+    char* chunk = (char*)malloc(XARGS_READ_CHUNK);
+    strbuf_t item;
+    ssize_t n;
+
+    sb_init(&item);
+    while (!batch->stop && (n = read(STDIN_FILENO, chunk, XARGS_READ_CHUNK)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("myshell: xargs: read error");
+            batch->status = 1;
+            break;
+        }
+
+        const char* start = chunk;
+        const char* end = chunk + n;
+        for (const char* p = chunk; p < end && !batch->stop; p++) {
+            int separator = null_separated ? (*p == '\0') : isspace((unsigned char)*p);
+            if (!separator) continue;
+
+            sb_append_n(&item, start, p - start);
+            if (item.len > 0) {
+                batch_add(batch, strdup(item.data));
+                sb_clear(&item);
+            }
+            start = p + 1;
+        }
+        sb_append_n(&item, start, end - start); // Partial item continues in the next chunk
+    }
+    if (item.len > 0 && !batch->stop) {
+        batch_add(batch, strdup(item.data));
+    }
+
+    sb_free(&item);
+    free(chunk);
+}
+
+int shell_xargs(command_t* cmd) {
+    char** args = cmd->arglist;
+    int null_separated = 0;
+    long max_items = 0;
+    int i = 1;
+
+    for (; args[i] != NULL && args[i][0] == '-'; i++) {
+        if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        } else if (strcmp(args[i], "-0") == 0) {
+            null_separated = 1;
+        } else if (strcmp(args[i], "-n") == 0 && args[i + 1] != NULL && atol(args[i + 1]) > 0) {
+            max_items = atol(args[++i]);
+        } else {
+            fprintf(stderr, "myshell: usage: xargs [-0] [-n MAX] [COMMAND [ARGS...]] [::: ITEMS...]\n");
+            return 1;
+        }
+    }
+
+    xargs_batch_t batch;
+    batch.cap = 64;
+    batch.argv = (char**)malloc(batch.cap * sizeof(char*));
+    batch.argc = 0;
+    batch.bytes = 0;
+    batch.limit = exec_arg_limit();
+    batch.max_items = (size_t)max_items;
+    batch.status = 0;
+    batch.stop = 0;
+
+    // The command and its initial arguments start every invocation (default: echo)
+    int items_from_args = 0;
+    for (; args[i] != NULL; i++) {
+        if (strcmp(args[i], ":::") == 0) {
+            items_from_args = 1;
+            i++;
+            break;
+        }
+        if (batch.argc + 2 > batch.cap) {
+            batch.cap *= 2;
+            batch.argv = (char**)realloc(batch.argv, batch.cap * sizeof(char*));
+        }
+        batch.argv[batch.argc++] = args[i];
+        batch.bytes += arg_cost(args[i]);
+    }
+    if (batch.argc == 0) {
+        batch.argv[batch.argc++] = "echo";
+        batch.bytes += arg_cost("echo");
+    }
+    batch.fixed = batch.argc;
+    batch.fixed_bytes = batch.bytes;
+
+    if (batch.bytes >= batch.limit) {
+        fprintf(stderr, "myshell: xargs: command line too long\n");
+        free(batch.argv);
+        return 1;
+    }
+
+    if (items_from_args) {
+        for (; args[i] != NULL && !batch.stop; i++) {
+            batch_add(&batch, strdup(args[i]));
+        }
+    } else {
+        read_items(&batch, null_separated);
+    }
+    if (!batch.stop) {
+        batch_run(&batch); // Nothing is run when there were no items at all
+    }
+
+    for (size_t j = batch.fixed; j < batch.argc; j++) {
+        free(batch.argv[j]);
+    }
+    free(batch.argv);
+    return batch.status;
+}
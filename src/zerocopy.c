@@ -0,0 +1,246 @@
+#include "shell.h"
+
+// --- cat and tee stage builtins ---
+//
+//   cat [FILE...]      ('-' or no FILE reads stdin)
+//   tee [-a] [FILE...]
+//
+// Both run inside a forked stage (see run_stage_builtin()) and keep the
+// data in the kernel where they can: copy_file_range() between regular
+// files, splice() whenever one side is a pipe, and tee(2) to duplicate a
+// pipe's contents for tee. Anything the kernel refuses (a terminal, an
+// O_APPEND file, an old kernel) falls back to large read()/write() calls.
+// Any other option leaves the command to the external program.
+
+#define COPY_CHUNK (1 << 20)          // Bytes per splice()/read() call
+#define COPY_FILE_CHUNK (1L << 30)    // Bytes per copy_file_range() call
+
+static char* fallback_buffer = NULL;
+
+static char* copy_buffer(void) {
+    if (fallback_buffer == NULL) {
+        fallback_buffer = (char*)malloc(COPY_CHUNK);
+    }
+    return fallback_buffer;
+}
+
+static int write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// The kernel cannot do this copy in place; user space has to
+static int unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP || err == EBADF;
+}
+
+// Copies everything from in to out. Returns 0, or -1 with errno set.
+static int copy_fd(int in, int out) {
+    struct stat in_st, out_st;
+    if (fstat(in, &in_st) < 0 || fstat(out, &out_st) < 0) return -1;
+
+    if (S_ISREG(in_st.st_mode) && S_ISREG(out_st.st_mode)) {
+        ssize_t n;
+        while ((n = copy_file_range(in, NULL, out, NULL, COPY_FILE_CHUNK, 0)) > 0);
+        if (n == 0) return 0;
+        if (errno != EINTR && !unsupported(errno)) return -1;
+    }
+
+    if (S_ISFIFO(in_st.st_mode) || S_ISFIFO(out_st.st_mode)) {
+        ssize_t n;
+        while ((n = splice(in, NULL, out, NULL, COPY_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE)) > 0 ||
+               (n < 0 && errno == EINTR));
+        if (n == 0) return 0;
+        if (!unsupported(errno)) return -1;
+    }
+
+    char* buffer = copy_buffer();
+    ssize_t n;
+    while ((n = read(in, buffer, COPY_CHUNK)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (write_all(out, buffer, n) < 0) return -1;
+    }
+    return 0;
+}
+
+static int cat_file(const char* name) {
+    int fd = strcmp(name, "-") == 0 ? STDIN_FILENO : open(name, O_RDONLY | O_CLOEXEC);
+    int status = 0;
+
+    if (fd < 0 || copy_fd(fd, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "myshell: cat: %s: %s\n", name, strerror(errno));
+        status = 1;
+    }
+    if (fd > STDIN_FILENO) close(fd);
+    return status;
+}
+
+int shell_cat(command_t* cmd) {
+    char** args = cmd->arglist;
+    int status = 0;
+
+    for (int i = 1; args[i] != NULL; i++) {
+        if (args[i][0] == '-' && args[i][1] != '\0') return -1; // Options: use the real cat
+    }
+
+    if (args[1] == NULL) {
+        return cat_file("-");
+    }
+    for (int i = 1; args[i] != NULL; i++) {
+        status |= cat_file(args[i]);
+    }
+    return status;
+}
+
+// Moves exactly len bytes out of the pipe from into to
+static int drain_pipe(int from, int to, size_t len) {
+    while (len > 0) {
+        ssize_t n = splice(from, NULL, to, NULL, len, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && unsupported(errno)) {
+            // E.g. an O_APPEND file: read the same bytes and write them
+            n = read(from, copy_buffer(), len < COPY_CHUNK ? len : COPY_CHUNK);
+            if (n > 0 && write_all(to, copy_buffer(), n) < 0) return -1;
+        }
+        if (n <= 0) return -1;
+        len -= n;
+    }
+    return 0;
+}
+
+// stdin and stdout are both pipes: tee(2) copies each chunk to stdout (and
+// to a spare pipe per extra file) without consuming it, and the last file
+// takes the original bytes. Returns 1 if tee(2) is unusable, before any
+// output was made.
+static int tee_pipes(int* files, int nfiles) {
+    int (*spares)[2] = nfiles > 1 ? calloc(nfiles - 1, sizeof(int[2])) : NULL;
+    size_t chunk = COPY_CHUNK;
+    int status = 0;
+
+    for (int f = 0; f < nfiles - 1; f++) {
+        if (pipe(spares[f]) < 0) {
+            for (int g = 0; g < f; g++) {
+                close(spares[g][0]);
+                close(spares[g][1]);
+            }
+            free(spares);
+            return 1;
+        }
+        // Each chunk has to fit in every spare pipe at once
+        fcntl(spares[f][1], F_SETPIPE_SZ, COPY_CHUNK);
+        int size = fcntl(spares[f][1], F_GETPIPE_SZ);
+        if (size > 0 && (size_t)size < chunk) chunk = size;
+    }
+
+    int first = 1;
+    while (status == 0) {
+        ssize_t n = tee(STDIN_FILENO, STDOUT_FILENO, chunk, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && first && unsupported(errno)) {
+            status = 1;
+            break;
+        }
+        if (n <= 0) {
+            if (n < 0) {
+                perror("myshell: tee");
+                status = -1;
+            }
+            break;
+        }
+        first = 0;
+
+        for (int f = 0; f < nfiles - 1 && status == 0; f++) {
+            if (tee(STDIN_FILENO, spares[f][1], n, 0) != n || drain_pipe(spares[f][0], files[f], n) < 0) {
+                perror("myshell: tee");
+                status = -1;
+            }
+        }
+        if (status == 0 && drain_pipe(STDIN_FILENO, files[nfiles - 1], n) < 0) {
+            perror("myshell: tee");
+            status = -1;
+        }
+    }
+
+    for (int f = 0; f < nfiles - 1; f++) {
+        close(spares[f][0]);
+        close(spares[f][1]);
+    }
+    free(spares);
+    return status;
+}
+
+int shell_tee(command_t* cmd) {
+    char** args = cmd->arglist;
+    int append = 0;
+    int i = 1;
+
+    for (; args[i] != NULL && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        if (strcmp(args[i], "-a") != 0) return -1; // Other options: use the real tee
+        append = 1;
+    }
+
+    int nfiles = 0;
+    int status = 0;
+    int nargs = 0;
+    while (args[i + nargs] != NULL) nargs++;
+    int* files = (int*)malloc((nargs ? nargs : 1) * sizeof(int));
+    for (; args[i] != NULL; i++) {
+        int fd = open(args[i], O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+        if (fd < 0) {
+            fprintf(stderr, "myshell: tee: %s: %s\n", args[i], strerror(errno));
+            status = 1;
+            continue;
+        }
+        files[nfiles++] = fd;
+    }
+
+    struct stat in_st, out_st;
+    int zero_copy = nfiles > 0 && fstat(STDIN_FILENO, &in_st) == 0 && fstat(STDOUT_FILENO, &out_st) == 0 &&
+                    S_ISFIFO(in_st.st_mode) && S_ISFIFO(out_st.st_mode);
+    int result = zero_copy ? tee_pipes(files, nfiles) : 1;
+
+    if (result == 1) {
+        // Plain copy to stdout and every file
+        char* buffer = copy_buffer();
+        ssize_t n;
+        result = 0;
+        while ((n = read(STDIN_FILENO, buffer, COPY_CHUNK)) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                perror("myshell: tee");
+                result = -1;
+                break;
+            }
+            if (write_all(STDOUT_FILENO, buffer, n) < 0) {
+                perror("myshell: tee");
+                result = -1;
+                break;
+            }
+            for (int f = 0; f < nfiles; f++) {
+                if (files[f] >= 0 && write_all(files[f], buffer, n) < 0) {
+                    perror("myshell: tee");
+                    close(files[f]);
+                    files[f] = -1; // Keep feeding the others, like GNU tee
+                    status = 1;
+                }
+            }
+        }
+    }
+
+    for (int f = 0; f < nfiles; f++) {
+        if (files[f] >= 0) close(files[f]);
+    }
+    free(files);
+    return result < 0 ? 1 : status;
+}
@@ -0,0 +1,115 @@
+// myshell-client: runs one command line in a `myshell --serve` instance.
+//
+// Passes this process's stdin, stdout and stderr to the server, so the
+// command reads and writes them directly, and runs it in this process's
+// working directory. Exits with the command's status.
+//
+// Usage: myshell-client SOCKET COMMAND [ARGS...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: myshell-client SOCKET COMMAND [ARGS...]\n");
+        return 2;
+    }
+
+    // The words are joined back into one line for the shell to parse
+    size_t line_len = 0;
+    for (int i = 2; i < argc; i++) {
+        line_len += strlen(argv[i]) + 1;
+    }
+    char* line = malloc(line_len);
+    line[0] = '\0';
+    for (int i = 2; i < argc; i++) {
+        if (i > 2) strcat(line, " ");
+        strcat(line, argv[i]);
+    }
+    line_len = strlen(line);
+    if (line_len > SERVER_LINE_MAX) {
+        fprintf(stderr, "myshell-client: command line too long\n");
+        return 2;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "myshell-client: socket path too long\n");
+        return 2;
+    }
+    strcpy(addr.sun_path, argv[1]);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("myshell-client: connect error");
+        return 2;
+    }
+
+    // An unreachable cwd (e.g. deleted) leaves the server's in place
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) cwd[0] = '\0';
+    size_t cwd_len = strlen(cwd);
+
+    // The line and cwd are sent as one payload
+    size_t payload_len = line_len + cwd_len;
+    line = realloc(line, payload_len + 1);
+    memcpy(line + line_len, cwd, cwd_len + 1);
+
+    server_request_t header = { SERVER_MAGIC, (uint32_t)line_len, (uint32_t)cwd_len };
+    struct iovec iov[2] = { { &header, sizeof(header) }, { line, payload_len } };
+    union {
+        char buf[CMSG_SPACE(SERVER_NFDS * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(SERVER_NFDS * sizeof(int));
+    int fds[SERVER_NFDS] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    // The descriptors travel with the first byte; the rest of a long line
+    // may need further writes.
+    ssize_t total = (ssize_t)(sizeof(header) + payload_len);
+    ssize_t sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    if (sent < 0) {
+        perror("myshell-client: send error");
+        return 2;
+    }
+    while (sent < total) {
+        size_t offset = (size_t)sent - sizeof(header); // The header always fits in one send
+        ssize_t n = send(sock, line + offset, payload_len - offset, MSG_NOSIGNAL);
+        if (n <= 0) {
+            perror("myshell-client: send error");
+            return 2;
+        }
+        sent += n;
+    }
+
+    server_reply_t reply;
+    if (recv(sock, &reply, sizeof(reply), MSG_WAITALL) != (ssize_t)sizeof(reply) || reply.magic != SERVER_MAGIC) {
+        fprintf(stderr, "myshell-client: no reply from server\n");
+        return 2;
+    }
+
+    close(sock);
+    free(line);
+    return reply.status;
+}
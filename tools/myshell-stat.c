@@ -0,0 +1,216 @@
+// myshell-stat: live view of running myshell instances.
+//
+// Maps every /dev/shm/myshell.<pid>.stats block read-only and prints one row
+// per shell. Nothing is locked and no signal is sent, so watching many
+// shells has no effect on them.
+//
+// Usage: myshell-stat [-w SECONDS] [PID...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "metrics.h"
+
+#define MAX_SHELLS 1024
+
+typedef struct snapshot_t {
+    shell_stats_t stats;
+    int alive;
+} snapshot_t;
+
+// Previous round, for per-second rates in watch mode
+static int prev_pids[MAX_SHELLS];
+static uint64_t prev_commands[MAX_SHELLS];
+static int prev_count = 0;
+
+// Blocks skipped because they belong to another user (mode 0600)
+static int denied = 0;
+// PIDs given on the command line that could not be read
+static int failed = 0;
+
+// Returns 0, or an errno value: EINVAL when the file is not a stats block
+static int read_block(const char* path, snapshot_t* out) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == EACCES || errno == EPERM) denied++;
+        return errno;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int error = errno;
+        close(fd);
+        return error;
+    }
+    if (st.st_size < (off_t)sizeof(shell_stats_t)) {
+        close(fd);
+        return EINVAL;
+    }
+    const shell_stats_t* block = mmap(NULL, sizeof(shell_stats_t), PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (block == MAP_FAILED) return error;
+
+    int ok = (__atomic_load_n(&block->magic, __ATOMIC_ACQUIRE) == SHELL_STATS_MAGIC &&
+              block->version == SHELL_STATS_VERSION && block->size == sizeof(shell_stats_t));
+    if (ok) {
+        shell_stats_t* s = &out->stats;
+        s->pid = block->pid;
+        s->start_time = block->start_time;
+        s->commands_executed = __atomic_load_n(&block->commands_executed, __ATOMIC_RELAXED);
+        s->forks = __atomic_load_n(&block->forks, __ATOMIC_RELAXED);
+        s->builtin_hits = __atomic_load_n(&block->builtin_hits, __ATOMIC_RELAXED);
+        s->jobs_active = __atomic_load_n(&block->jobs_active, __ATOMIC_RELAXED);
+        s->jobs_finished = __atomic_load_n(&block->jobs_finished, __ATOMIC_RELAXED);
+        s->child_cpu_us = __atomic_load_n(&block->child_cpu_us, __ATOMIC_RELAXED);
+        s->parse_time_ns = __atomic_load_n(&block->parse_time_ns, __ATOMIC_RELAXED);
+        s->parse_count = __atomic_load_n(&block->parse_count, __ATOMIC_RELAXED);
+
+        // Sequence-counter read of the current command; give up after a few tries
+        s->current_command[0] = '\0';
+        for (int attempt = 0; attempt < 100; attempt++) {
+            uint64_t before = __atomic_load_n(&block->command_seq, __ATOMIC_ACQUIRE);
+            if (before & 1) continue;
+            memcpy(s->current_command, block->current_command, SHELL_STATS_CMD_MAX);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&block->command_seq, __ATOMIC_RELAXED) == before) break;
+            s->current_command[0] = '\0';
+        }
+        s->current_command[SHELL_STATS_CMD_MAX - 1] = '\0';
+
+        // A shell that died without cleaning up leaves its block behind
+        char proc_path[64];
+        snprintf(proc_path, sizeof(proc_path), "/proc/%d", (int)s->pid);
+        out->alive = (access(proc_path, F_OK) == 0);
+    }
+
+    munmap((void*)block, sizeof(shell_stats_t));
+    return ok ? 0 : EINVAL;
+}
+
+static int collect(int argc, char** argv, int first_pid_arg, snapshot_t* snaps) {
+    char path[512];
+    int count = 0;
+
+    if (first_pid_arg < argc) {
+        for (int i = first_pid_arg; i < argc && count < MAX_SHELLS; i++) {
+            snprintf(path, sizeof(path), "%s/%s%s%s", SHELL_STATS_DIR, SHELL_STATS_PREFIX, argv[i], SHELL_STATS_SUFFIX);
+            int error = read_block(path, &snaps[count]);
+            if (error == 0) {
+                count++;
+                continue;
+            }
+            failed++;
+            fprintf(stderr, "myshell-stat: %s: %s\n", path,
+                    error == EINVAL ? "not a myshell stats block" : strerror(error));
+        }
+        return count;
+    }
+
+    DIR* dir = opendir(SHELL_STATS_DIR);
+    if (dir == NULL) return 0;
+    struct dirent* entry;
+    size_t prefix_len = strlen(SHELL_STATS_PREFIX);
+    size_t suffix_len = strlen(SHELL_STATS_SUFFIX);
+    while ((entry = readdir(dir)) != NULL && count < MAX_SHELLS) {
+        size_t len = strlen(entry->d_name);
+        if (len <= prefix_len + suffix_len) continue;
+        if (strncmp(entry->d_name, SHELL_STATS_PREFIX, prefix_len) != 0) continue;
+        if (strcmp(entry->d_name + len - suffix_len, SHELL_STATS_SUFFIX) != 0) continue;
+
+        snprintf(path, sizeof(path), "%s/%s", SHELL_STATS_DIR, entry->d_name);
+        if (read_block(path, &snaps[count]) == 0) count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+static uint64_t previous_commands(int pid, int* found) {
+    for (int i = 0; i < prev_count; i++) {
+        if (prev_pids[i] == pid) {
+            *found = 1;
+            return prev_commands[i];
+        }
+    }
+    *found = 0;
+    return 0;
+}
+
+static void print_table(snapshot_t* snaps, int count, double interval) {
+    printf("%-8s %-5s %9s %8s %8s %7s %8s %10s %9s %8s  %s\n",
+           "PID", "STATE", "CMDS", "CMD/s", "FORKS", "BUILTIN", "JOBS", "CHILD_CPU", "PARSE_us", "UPTIME", "CURRENT");
+
+    time_t now = time(NULL);
+    for (int i = 0; i < count; i++) {
+        shell_stats_t* s = &snaps[i].stats;
+        int found;
+        uint64_t prev = previous_commands(s->pid, &found);
+        double rate = (found && interval > 0) ? (double)(s->commands_executed - prev) / interval : 0.0;
+        double parse_avg = s->parse_count ? (double)s->parse_time_ns / s->parse_count / 1000.0 : 0.0;
+        char jobs[32];
+        snprintf(jobs, sizeof(jobs), "%llu/%llu",
+                 (unsigned long long)s->jobs_active, (unsigned long long)s->jobs_finished);
+
+        printf("%-8d %-5s %9llu %8.1f %8llu %7llu %8s %9.2fs %9.1f %7llds  %s\n",
+               (int)s->pid, snaps[i].alive ? "up" : "dead",
+               (unsigned long long)s->commands_executed, rate,
+               (unsigned long long)s->forks, (unsigned long long)s->builtin_hits, jobs,
+               s->child_cpu_us / 1e6, parse_avg, (long long)(now - (time_t)s->start_time),
+               s->current_command[0] ? s->current_command : "-");
+    }
+
+    prev_count = count;
+    for (int i = 0; i < count; i++) {
+        prev_pids[i] = snaps[i].stats.pid;
+        prev_commands[i] = snaps[i].stats.commands_executed;
+    }
+}
+
+int main(int argc, char** argv) {
+    double interval = 0;
+    int first_pid_arg = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-w") == 0) {
+        interval = atof(argv[2]);
+        first_pid_arg = 3;
+        if (interval <= 0) {
+            fprintf(stderr, "usage: myshell-stat [-w SECONDS] [PID...]\n");
+            return 1;
+        }
+    }
+
+    static snapshot_t snaps[MAX_SHELLS];
+    do {
+        denied = 0;
+        failed = 0;
+        int count = collect(argc, argv, first_pid_arg, snaps);
+        if (interval > 0) {
+            printf("\033[H\033[2J"); // Redraw in place
+        }
+        if (count == 0 && failed == 0) {
+            printf("No running myshell instances.\n");
+        } else if (count > 0) {
+            print_table(snaps, count, interval);
+        }
+        if (denied > 0 && first_pid_arg >= argc) {
+            printf("(%d shell%s of other users not readable)\n", denied, denied == 1 ? "" : "s");
+        }
+        fflush(stdout);
+
+        if (interval > 0) {
+            struct timespec ts = { (time_t)interval, (long)((interval - (time_t)interval) * 1e9) };
+            nanosleep(&ts, NULL);
+        }
+    } while (interval > 0);
+
+    // Unreadable shells are only an error when asked for by pid
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#!/bin/sh
+# ==============================
+# Pipeline throughput benchmark for myshell
+# ==============================
+#
+# Streams BYTES of /dev/zero through 1..MAX_STAGES `cat` stages for every
+# combination of pipe size and pinning mode, and prints the throughput so the
+# best `set -o pipesize=... pinning=...` settings can be picked per host.
+# `cat` is the shell's splice-based builtin; CAT=/bin/cat compares against
+# the external tool. Each run is paired with the same pipeline on 0 bytes,
+# whose time (shell startup, forks, exits) is subtracted.
+#
+# Usage: tools/pipe_bench.sh [BYTES] [MAX_STAGES] [PIPESIZES] [PINNINGS]
+#   e.g. tools/pipe_bench.sh 2g 6 "0 256k 1m" "off rr"
+
+SHELL_BIN=${SHELL_BIN:-./bin/myshell}
+CAT=${CAT:-cat}
+BYTES=${1:-1g}
+MAX_STAGES=${2:-4}
+PIPESIZES=${3:-"0 256k 1m"}
+PINNINGS=${4:-"off rr"}
+
+case $BYTES in
+    *g|*G) COUNT=$(( ${BYTES%?} * 1024 * 1024 * 1024 )) ;;
+    *m|*M) COUNT=$(( ${BYTES%?} * 1024 * 1024 )) ;;
+    *)     COUNT=$BYTES ;;
+esac
+
+if [ ! -x "$SHELL_BIN" ]; then
+    echo "pipe_bench: $SHELL_BIN not found, run make first" >&2
+    exit 1
+fi
+
+now() { date +%s.%N; }
+
+# Seconds one shell takes to run the pipeline for `head -c $1`
+run_pipeline() {
+    start=$(now)
+    printf 'set -o pipesize=%s\nset -o pinning=%s\nhead -c %s /dev/zero%s > /dev/null\n' \
+        "$size" "$pin" "$1" "$stages_text" | "$SHELL_BIN" --norc > /dev/null
+    end=$(now)
+    echo "$start $end" | awk '{ print $2 - $1 }'
+}
+
+printf "%-8s %-8s %-7s %10s %10s\n" stages pipesize pinning seconds "GB/s"
+for stages in $(seq 1 "$MAX_STAGES"); do
+    stages_text=""
+    i=0
+    while [ $i -lt "$stages" ]; do
+        stages_text="$stages_text | $CAT"
+        i=$((i + 1))
+    done
+
+    for size in $PIPESIZES; do
+        for pin in $PINNINGS; do
+            base=$(run_pipeline 0)
+            full=$(run_pipeline "$COUNT")
+            echo "$base $full $COUNT" | awk -v s="$stages" -v p="$size" -v n="$pin" \
+                '{ t = $2 - $1; if (t <= 0) t = 1e-9
+                   printf "%-8s %-8s %-7s %10.3f %10.2f\n", s, p, n, t, $3 / t / 1e9 }'
+        done
+    done
+done